@@ -6,6 +6,8 @@
 #include "emu.h"
 
 #include <LUFA/Drivers/Peripheral/Serial.h>
+#include <util/atomic.h>
+#include <avr/eeprom.h>
 #include "../include/protocol.h"
 
 #define MAX_CONTROL_TRANSFER_SIZE MAX_PACKET_VALUE_SIZE
@@ -20,39 +22,205 @@
 #define LED2_ON      (PORTB &= ~(1<<0))
 #define LED2_OFF     (PORTB |= (1<<0))
 
+#define MAX_CACHED_IN 2 // IN endpoints that can keep their last report
+
 /*
- * The access to these variables is synchronized.
+ * The body of the busy waits on an interrupt, the host build (fw/sim) runs the interrupts there.
  */
-static uint8_t control[MAX_CONTROL_TRANSFER_SIZE];
+#ifndef WAIT_INTERRUPT
+#define WAIT_INTERRUPT()
+#endif
 
-static s_endpointPacket input;
-static uint8_t inputDataLen;
+#define DPRAM_SIZE 832 // endpoint memory of the atmega32u4
 
-static uint8_t descriptors[MAX_DESCRIPTORS_SIZE];
-static s_descriptorIndex descIndex[MAX_DESCRIPTORS];
-static s_endpointConfig endpoints[MAX_ENDPOINTS];
+/*
+ * The serial interrupt only pushes the received bytes into this ring buffer.
+ * The frames are assembled in the main, by ProcessSerial().
+ * The indexes wrap naturally (RX_BUFFER_SIZE is 256).
+ */
+#define RX_BUFFER_SIZE 256
+
+static uint8_t rxBuffer[RX_BUFFER_SIZE];
+static volatile uint8_t rxHead = 0; // written by the serial interrupt
+static volatile uint8_t rxTail = 0; // written by the main
+
+/*
+ * The frames to send are queued into these ring buffers,
+ * and the UDRE interrupt drains them.
+ * Between two frames, the acks are sent before the data (OUT, control).
+ * The indexes are free running, the sizes are powers of 2.
+ */
+#define TX_DATA_SIZE 128
+#define TX_ACK_SIZE 32
+
+static uint8_t txData[TX_DATA_SIZE];
+static volatile uint8_t txDataHead = 0; // written by the main
+static volatile uint8_t txDataTail = 0; // written by the UDRE interrupt
+
+static uint8_t txAck[TX_ACK_SIZE];
+static volatile uint8_t txAckHead = 0; // written by the main
+static volatile uint8_t txAckTail = 0; // written by the UDRE interrupt
 
 /*
- * Only used in the serial interrupt.
+ * Only used in the UDRE interrupt.
  */
-static uint8_t * pdesc = descriptors;
-static uint8_t * pindex = (uint8_t *)descIndex;
+static uint8_t txFromAck = 0; // the current frame is an ack
+static uint8_t txHeader = 0; // header bytes left in the current frame
+static uint8_t txRemaining = 0; // value bytes left in the current frame
 
 /*
  * Only used in the main.
  */
+static uint8_t control[MAX_CONTROL_TRANSFER_SIZE];
+
+/*
+ * The descriptors are uploaded before USB_Init, and the IN queue
+ * is only used after it, so they share the same memory.
+ */
+static union {
+    uint8_t upload[MAX_STORED_CONFIG_SIZE]; // the descriptors, then their index
+    struct {
+        uint8_t length;
+        s_endpointPacket packet;
+    } inQueue[IN_QUEUE_SIZE];
+} shared;
+
+#define inQueue shared.inQueue
+
+static uint8_t inQueueHead = 0;
+static uint8_t inQueueTail = 0;
+
+#define IN_QUEUE_INDEX(INDEX) ((INDEX) & (IN_QUEUE_SIZE - 1))
+
+static s_endpointConfig endpoints[MAX_ENDPOINTS];
+
+static uint8_t * pupload = shared.upload;
+static uint8_t * pindex = NULL; // start of the uploaded index
+static uint32_t uploadHash = 0;
+static uint32_t receivedHash = CONFIG_HASH_INIT; // hash of the received descriptors and index
+static uint16_t configChecksum = 0;
+
+/*
+ * The last uploaded descriptors are kept in the EEPROM with the hash
+ * the host computed over them. The index follows the descriptors.
+ */
+typedef struct {
+    uint32_t hash;
+    uint16_t descriptorsLength;
+    uint8_t indexCount;
+} s_storeHeader;
+
+static s_storeHeader EEMEM storeHeader;
+static uint8_t EEMEM storeData[MAX_STORED_CONFIG_SIZE];
+
+static s_storeHeader store; // copy of storeHeader
+
 static uint8_t outEndpoints[MAX_ENDPOINTS];
 static uint8_t selectedOutEndpoint = 0;
 static uint8_t outEndpointNumber = 0;
+static uint8_t inCredits = 0; // IN slots freed but not yet returned to the host
+static uint32_t inTimes[IN_CREDIT_BATCH]; // clock of the Endpoint_ClearIN of each credit
+
+/*
+ * The bank of pollEndpoint is watched after each Endpoint_ClearIN,
+ * the console poll that takes the report empties it.
+ */
+static uint8_t pollEndpoint = 0;
+static uint8_t pollPending = 0;
+static uint32_t lastPoll = 0;
+
+static struct inCacheEntry {
+    uint8_t endpoint; // 0 means unused
+    uint8_t length; // 0 means no report yet
+    uint8_t armed; // the endpoint bank holds a copy of the report
+    uint8_t data[MAX_PAYLOAD_SIZE_EP];
+} inCache[MAX_CACHED_IN];
+
+static s_counters counters;
+
+/*
+ * Timer 1 overflows, the high word of the clock.
+ */
+static uint16_t clockHigh = 0;
+static uint8_t countersDue = 0;
+
+/*
+ * The 32-bit clock, in 16 us ticks (see FW_CLOCK_TICK_US).
+ */
+static uint32_t GetClock(void) {
+
+    uint16_t high = clockHigh;
+    uint16_t low = TCNT1;
+    if ((TIFR1 & (1 << TOV1)) && low < 0x8000) {
+        ++high; // the overflow is not processed yet
+    }
+    return ((uint32_t)high << 16) | low;
+}
 
 /*
- * These variables are used in both the main and the serial interrupt,
- * therefore they have to be declared as volatile.
+ * Written by the serial interrupts, copied into the counters by the main.
+ * The interrupts are timed with timer 0 (FCPU/8).
  */
-static volatile uint8_t started = 0;
-static volatile uint8_t controlReply = 0;
-static volatile uint8_t controlStall = 0;
-static volatile uint8_t controlReplyLen = 0;
+static volatile uint16_t rxOverruns = 0;
+static volatile uint8_t maxIsrTime = 0;
+
+#define ISR_TIME_START() uint8_t isrStart = TCNT0
+
+#define ISR_TIME_END() \
+    { \
+        uint8_t isrTime = TCNT0 - isrStart; \
+        if (isrTime > maxIsrTime) { \
+            maxIsrTime = isrTime; \
+        } \
+    }
+
+#define HID_REPORT_TYPE_FEATURE 3 // high byte of wValue in GET_REPORT
+
+static uint8_t features[MAX_FEATURES_SIZE];
+static uint8_t featuresLength = 0;
+static volatile uint8_t localHid = 0; // the HID class requests are answered locally
+static uint8_t hidIdle = 0;
+static uint8_t hidProtocol = 1; // report protocol
+
+static uint8_t started = 0;
+static uint8_t controlReply = 0;
+static uint8_t controlStall = 0;
+static uint8_t controlReplyLen = 0;
+static uint16_t controlStart = 0; // TCNT1 when the control request was forwarded
+
+#define CONTROL_TIMEOUT 3125 // 50 ms at FCPU/256
+
+/*
+ * The control requests are relayed by a state machine, see ControlTask().
+ * With INTERRUPT_CONTROL_ENDPOINT, the USB events run in the USB interrupt,
+ * so they only record what the main has to do.
+ */
+static volatile enum {
+    CONTROL_IDLE,
+    CONTROL_DEBUG, // the request is too large to be relayed
+    CONTROL_FORWARD, // the request has to be sent to the host
+    CONTROL_WAIT, // the data or status stage is NAKed until the host replies
+} controlState = CONTROL_IDLE;
+static USB_Request_Header_t controlRequest;
+static volatile uint8_t configured = 0;
+
+/*
+ * State of the frame being received.
+ */
+static struct {
+    enum {
+        RX_STATE_TYPE,
+        RX_STATE_LENGTH,
+        RX_STATE_VALUE,
+    } state;
+    uint8_t type;
+    uint8_t length;
+    uint8_t remaining;
+    uint8_t * target; // NULL means the value is dropped
+    uint8_t * end;
+    uint8_t checksum; // the value is part of the configuration
+    uint8_t hash; // the value is part of the descriptors or index
+} rx;
 
 static inline void forceHardReset(void) {
   LED_OFF;
@@ -64,85 +232,325 @@ static inline void forceHardReset(void) {
     while(1); // wait for watchdog to reset processor
 }
 
-static inline int8_t Serial_BlockingReceiveByte(void) {
-  LED2_ON;
-    while(!Serial_IsCharReceived()) {}
-  LED2_OFF;
-    return UDR1;
+static inline void SendNextByte(void) {
+
+    uint8_t byte;
+
+    if (!txHeader && !txRemaining) {
+        // frame boundary: the acks go first
+        if (txAckTail != txAckHead) {
+            txFromAck = 1;
+        } else if (txDataTail != txDataHead) {
+            txFromAck = 0;
+        } else {
+            UCSR1B &= ~(1 << UDRIE1);
+            return;
+        }
+        txHeader = 2;
+    }
+
+    if (txFromAck) {
+        // the acks are queued as whole frames
+        uint8_t tail = txAckTail;
+        byte = txAck[tail & (TX_ACK_SIZE - 1)];
+        txAckTail = tail + 1;
+    } else {
+        uint8_t tail = txDataTail;
+        if (tail == txDataHead) {
+            // the rest of the frame is not queued yet
+            UCSR1B &= ~(1 << UDRIE1);
+            return;
+        }
+        byte = txData[tail & (TX_DATA_SIZE - 1)];
+        txDataTail = tail + 1;
+    }
+
+    UDR1 = byte;
+
+    if (txHeader) {
+        if (--txHeader == 0) {
+            txRemaining = byte; // this is the length
+        }
+    } else {
+        --txRemaining;
+    }
+}
+
+ISR(USART1_UDRE_vect) {
+    ISR_TIME_START();
+    SendNextByte();
+    ISR_TIME_END();
 }
 
-static inline void send_control_header(void) {
+/*
+ * Queue data bytes, waiting for room if the ring buffer is full.
+ */
+static void Serial_QueueData(const void * data, uint8_t length) {
+
+    const uint8_t * ptr = data;
 
-    uint8_t len = sizeof(USB_ControlRequest);
-    if( !(USB_ControlRequest.bmRequestType & REQDIR_DEVICETOHOST) ) {
-        len += USB_ControlRequest.wLength;
+    while (length--) {
+        uint8_t head = txDataHead;
+        while ((uint8_t)(head - txDataTail) == TX_DATA_SIZE) {
+            WAIT_INTERRUPT();
+        }
+        txData[head & (TX_DATA_SIZE - 1)] = *(ptr++);
+        txDataHead = head + 1;
+        UCSR1B |= (1 << UDRIE1);
     }
-    Serial_SendByte(E_TYPE_CONTROL);
-    Serial_SendByte(len);
-    Serial_SendData(&USB_ControlRequest, sizeof(USB_ControlRequest));
 }
 
-#define READ_VALUE_INC(TARGET) \
-    while (value_len--) { \
-        *(TARGET++) = Serial_BlockingReceiveByte(); \
+/*
+ * Queue a whole ack frame, an ack larger than the ring is dropped.
+ */
+static void Serial_QueueAck(const uint8_t type, const void * value, uint8_t length) {
+
+    if (length > TX_ACK_SIZE - 2) {
+        return;
     }
 
-#define READ_VALUE(TARGET) \
-    { \
-        uint8_t * ptr = TARGET; \
-        READ_VALUE_INC(ptr) \
+    const uint8_t * ptr = value;
+    uint8_t head = txAckHead;
+
+    while ((uint8_t)(head - txAckTail) > (uint8_t)(TX_ACK_SIZE - 2 - length)) {
+        WAIT_INTERRUPT();
     }
 
-static inline void ack(const uint8_t type) {
-    //LED2_ON;
-    Serial_SendByte(type);
-    Serial_SendByte(BYTE_LEN_0_BYTE);
-    //int i; for (i = 0; i < 2000; i++);
-    //LED2_OFF;
+    txAck[head++ & (TX_ACK_SIZE - 1)] = type;
+    txAck[head++ & (TX_ACK_SIZE - 1)] = length;
+    while (length--) {
+        txAck[head++ & (TX_ACK_SIZE - 1)] = *(ptr++);
+    }
+
+    txAckHead = head;
+    UCSR1B |= (1 << UDRIE1);
+}
+
+static inline void send_control_header(void) {
+
+    uint8_t header[2] = { E_TYPE_CONTROL, sizeof(controlRequest) };
+    if( !(controlRequest.bmRequestType & REQDIR_DEVICETOHOST) ) {
+        header[1] += controlRequest.wLength;
+    }
+    Serial_QueueData(header, sizeof(header));
+    Serial_QueueData(&controlRequest, sizeof(controlRequest));
 }
 
+static inline void ack(const uint8_t type) {
+    Serial_QueueAck(type, NULL, 0);
+}
 
 ISR(USART1_RX_vect) {
-  LED_OFF;
-    uint8_t packet_type = UDR1;
-    uint8_t value_len = Serial_BlockingReceiveByte();
-    static const void * labels[] = { &&l_descriptors, &&l_index, &&l_endpoints, &&l_reset, &&l_control, &&l_control_stall, &&l_in };
-    if(packet_type > E_TYPE_IN) {
+    ISR_TIME_START();
+    if (UCSR1A & (1 << DOR1)) {
+        ++rxOverruns;
+    }
+    uint8_t byte = UDR1;
+    uint8_t head = rxHead;
+    if ((uint8_t)(head + 1) != rxTail) {
+        rxBuffer[head] = byte;
+        rxHead = head + 1;
+    } else {
+        ++rxOverruns;
+    }
+    ISR_TIME_END();
+}
+
+/*
+ * Select where the value of the incoming frame is stored.
+ */
+static inline void StartFrame(void) {
+
+    rx.target = NULL;
+    rx.checksum = 0;
+    rx.hash = 0;
+
+    switch (rx.type) {
+    case E_TYPE_DESCRIPTORS:
+        if (!started) {
+            rx.target = pupload;
+            rx.end = shared.upload + sizeof(shared.upload);
+            rx.checksum = 1;
+            rx.hash = 1;
+        }
+        break;
+    case E_TYPE_INDEX:
+        if (!started) {
+            if (pindex == NULL) {
+                pindex = pupload;
+            }
+            rx.target = pupload;
+            rx.end = shared.upload + sizeof(shared.upload);
+            rx.checksum = 1;
+            rx.hash = 1;
+        }
+        break;
+    case E_TYPE_HASH:
+        rx.target = (uint8_t *)&uploadHash;
+        rx.end = rx.target + sizeof(uploadHash);
+        break;
+    case E_TYPE_ENDPOINTS:
+        rx.target = (uint8_t *)endpoints;
+        rx.end = (uint8_t *)endpoints + sizeof(endpoints);
+        rx.checksum = 1;
+        break;
+    case E_TYPE_CONTROL:
+    case E_TYPE_CONTROL_STALL:
+        rx.target = control;
+        rx.end = control + sizeof(control);
+        break;
+    case E_TYPE_FEATURES:
+        rx.target = features + featuresLength;
+        rx.end = features + sizeof(features);
+        break;
+    case E_TYPE_IN:
+        if ((uint8_t)(inQueueTail - inQueueHead) < IN_QUEUE_SIZE && rx.length > 0
+                && rx.length <= sizeof(s_endpointPacket)) {
+            rx.target = (uint8_t *)&inQueue[IN_QUEUE_INDEX(inQueueTail)].packet;
+            rx.end = rx.target + sizeof(s_endpointPacket);
+        }
+        // else the host sent more packets than advertised, or a report larger than an endpoint: drop
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Write the uploaded descriptors and index to the EEPROM (about 3.4 ms per changed byte).
+ * The hash is written last, so that an interrupted write is not used,
+ * and only if the received bytes match it, so that a corrupted upload is sent again.
+ */
+static void StoreDescriptors(void) {
+
+    if (pindex == NULL) {
+        pindex = pupload; // no index
+    }
+
+    store.hash = 0xffffffff;
+    store.descriptorsLength = pindex - shared.upload;
+    store.indexCount = (pupload - pindex) / sizeof(s_descriptorIndex);
+
+    eeprom_update_block(&store, &storeHeader, sizeof(store));
+    eeprom_update_block(shared.upload, storeData, pupload - shared.upload);
+
+    if (receivedHash != uploadHash) {
         return;
     }
-    goto *labels[packet_type];
-    l_descriptors:
-    READ_VALUE_INC(pdesc)
-    ack(E_TYPE_DESCRIPTORS);
-    return;
-    l_index:
-    READ_VALUE_INC(pindex)
-    ack(E_TYPE_INDEX);
-    LED_ON;
-    return;
-    l_endpoints:
-    READ_VALUE((uint8_t*)&endpoints)
-    ack(E_TYPE_ENDPOINTS);
-    started = 1;
-    LED_ON;
-    return;
-    l_reset:
-    forceHardReset();
-    return;
-    l_control:
-    controlReplyLen = value_len;
-    READ_VALUE(control)
-    controlReply = 1;
-    return;
-    l_control_stall:
-    READ_VALUE(control)
-    controlReply = 1;
-    controlStall = 1;
-    return;
-    l_in:
-    inputDataLen = value_len - 1;
-    READ_VALUE((uint8_t*)&input)
-    return;
+
+    store.hash = uploadHash;
+    eeprom_update_dword(&storeHeader.hash, store.hash);
+}
+
+/*
+ * Process the frame once its value is received.
+ */
+static inline void EndFrame(void) {
+
+    switch (rx.type) {
+    case E_TYPE_DESCRIPTORS:
+    case E_TYPE_INDEX:
+        if (rx.target != NULL) {
+            pupload = rx.target;
+        }
+        break;
+    case E_TYPE_HASH:
+        {
+            uint8_t match = (rx.length == sizeof(uploadHash) && uploadHash == store.hash
+                    && store.indexCount <= MAX_DESCRIPTORS);
+            Serial_QueueAck(E_TYPE_HASH, &match, sizeof(match));
+        }
+        break;
+    case E_TYPE_ENDPOINTS:
+        if (!started && pupload != shared.upload) {
+            StoreDescriptors();
+        }
+        {
+            s_endpointsAck endpointsAck = { .inSlots = IN_QUEUE_SIZE, .checksum = configChecksum };
+            Serial_QueueAck(E_TYPE_ENDPOINTS, &endpointsAck, sizeof(endpointsAck));
+        }
+        started = 1;
+        LED_ON;
+        break;
+    case E_TYPE_RESET:
+        forceHardReset();
+        break;
+    case E_TYPE_CONTROL:
+        controlReplyLen = rx.length;
+        controlReply = 1;
+        break;
+    case E_TYPE_CONTROL_STALL:
+        controlReply = 1;
+        controlStall = 1;
+        break;
+    case E_TYPE_IN:
+        if (rx.target != NULL) {
+            inQueue[IN_QUEUE_INDEX(inQueueTail)].length = rx.length - 1;
+            ++inQueueTail;
+        }
+        break;
+    case E_TYPE_FEATURES:
+        if (rx.target - (features + featuresLength) == rx.length) {
+            featuresLength += rx.length; // else the reports don't fit: drop them
+        }
+        localHid = 1;
+        break;
+    case E_TYPE_PING:
+        {
+            uint32_t clock = GetClock();
+            Serial_QueueAck(E_TYPE_PING, &clock, sizeof(clock));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Assemble the frames from the received bytes.
+ */
+void ProcessSerial(void) {
+
+    uint8_t tail = rxTail;
+
+    while (tail != rxHead) {
+
+        uint8_t byte = rxBuffer[tail++];
+
+        switch (rx.state) {
+        case RX_STATE_TYPE:
+            LED_OFF;
+            rx.type = byte;
+            rx.state = RX_STATE_LENGTH;
+            break;
+        case RX_STATE_LENGTH:
+            rx.length = byte;
+            rx.remaining = byte;
+            StartFrame();
+            rx.state = RX_STATE_VALUE;
+            break;
+        case RX_STATE_VALUE:
+            --rx.remaining;
+            if (rx.checksum) {
+                configChecksum = config_checksum(configChecksum, byte);
+            }
+            if (rx.target != NULL && rx.target < rx.end) {
+                *(rx.target++) = byte;
+                if (rx.hash) {
+                    receivedHash = config_hash(receivedHash, byte); // only the stored bytes
+                }
+            }
+            break;
+        }
+
+        if (rx.state == RX_STATE_VALUE && rx.remaining == 0) {
+            rxTail = tail; // release the space before a possibly long processing
+            EndFrame();
+            rx.state = RX_STATE_TYPE;
+        }
+    }
+
+    rxTail = tail;
 }
 
 void serial_init(void) {
@@ -172,7 +580,14 @@ void SetupHardware(void) {
     LED_OFF;
     LED2_OFF;
 
-    while(!started) {}
+    TCCR0B |= (1 << CS01); // Set up timer 0 at FCPU /8 (interrupt timing)
+
+    eeprom_read_block(&store, &storeHeader, sizeof(store));
+
+    while(!started) {
+        ProcessSerial();
+        WAIT_INTERRUPT();
+    }
 
     TCCR1B |= (1 << CS12); // Set up timer at FCPU /256
 
@@ -189,26 +604,41 @@ void EVENT_USB_Device_Disconnect(void) {
 
 void EVENT_USB_Device_ConfigurationChanged(void) {
 
+    uint8_t inCachedNumber = 0;
+    uint16_t dpram = USB_Device_ControlEndpointSize;
     uint8_t i;
     for (i = 0; i < sizeof(endpoints) / sizeof(*endpoints) && endpoints[i].number; ++i) {
         if(endpoints[i].type == EP_TYPE_INTERRUPT) {
-            Endpoint_ConfigureEndpoint(endpoints[i].number, endpoints[i].type, endpoints[i].size, 1);
+            uint8_t banks = 1;
+            if ((endpoints[i].flags & EP_FLAG_DOUBLE_BANK) && dpram + 2 * endpoints[i].size <= DPRAM_SIZE) {
+                banks = 2;
+            }
+            dpram += banks * endpoints[i].size;
+            Endpoint_ConfigureEndpoint(endpoints[i].number, endpoints[i].type, endpoints[i].size, banks);
         }
         //TODO MLA: other endpoint types
         if((endpoints[i].number & ENDPOINT_DIR_MASK) == ENDPOINT_DIR_OUT) {
             outEndpoints[outEndpointNumber++] = i;
+        } else if ((endpoints[i].flags & EP_FLAG_CACHED) && inCachedNumber < MAX_CACHED_IN) {
+            inCache[inCachedNumber++].endpoint = endpoints[i].number;
         }
     }
+
+    configured = 1;
 }
 
 uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue, const uint16_t wIndex,
         const void** const DescriptorAddress) {
 
+    const s_descriptorIndex * index = (const s_descriptorIndex *)(storeData + store.descriptorsLength);
+
     uint8_t i;
-    for (i = 0; i < sizeof(descIndex) / sizeof(*descIndex) && descIndex[i].wValue; ++i) {
-        if(wValue == descIndex[i].wValue && wIndex == descIndex[i].wIndex) {
-            *DescriptorAddress = descriptors + descIndex[i].offset;
-            return descIndex[i].wLength;
+    for (i = 0; i < store.indexCount; ++i) {
+        s_descriptorIndex entry;
+        eeprom_read_block(&entry, index + i, sizeof(entry));
+        if(wValue == entry.wValue && wIndex == entry.wIndex) {
+            *DescriptorAddress = storeData + entry.offset; // LUFA reads it from the EEPROM
+            return entry.wLength;
         }
     }
 
@@ -217,139 +647,495 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue, const uint16_t wIndex
 
 bool EVENT_USB_Device_ControlRequest(void) {
 
+    controlState = CONTROL_IDLE; // a new request aborts the pending one
+
     return false;
 }
 
+static inline const uint8_t * getFeature(uint8_t reportId, uint8_t interface) {
+
+    const uint8_t * ptr = features;
+    while (ptr < features + featuresLength) {
+        const s_featureHeader * header = (const s_featureHeader *)ptr;
+        if (header->reportId == reportId && header->interface == interface) {
+            return ptr;
+        }
+        ptr += sizeof(*header) + header->length;
+    }
+    return NULL;
+}
+
+/*
+ * Answer the standard HID class requests without a round trip to the host.
+ */
+static inline bool AnswerHidRequest(void) {
+
+    uint8_t bmRequestType = USB_ControlRequest.bmRequestType;
+    const uint8_t * data = NULL;
+    uint8_t length = 1;
+
+    if (bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE)) {
+        switch (USB_ControlRequest.bRequest) {
+        case HID_REQ_SetIdle:
+            hidIdle = USB_ControlRequest.wValue >> 8;
+            break;
+        case HID_REQ_SetProtocol:
+            hidProtocol = USB_ControlRequest.wValue & 0xff;
+            break;
+        default:
+            return false;
+        }
+        Endpoint_ClearSETUP();
+        Endpoint_ClearStatusStage();
+        ++counters.localControls;
+        return true;
+    }
+
+    if (bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+        switch (USB_ControlRequest.bRequest) {
+        case HID_REQ_GetIdle:
+            data = &hidIdle;
+            break;
+        case HID_REQ_GetProtocol:
+            data = &hidProtocol;
+            break;
+        case HID_REQ_GetReport:
+            if ((USB_ControlRequest.wValue >> 8) == HID_REPORT_TYPE_FEATURE) {
+                data = getFeature(USB_ControlRequest.wValue & 0xff, USB_ControlRequest.wIndex);
+                if (data != NULL) {
+                    length = ((const s_featureHeader *)data)->length;
+                    data += sizeof(s_featureHeader);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    } else if (bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_STANDARD | REQREC_INTERFACE)
+            && USB_ControlRequest.bRequest == REQ_GetStatus) {
+        static const uint8_t status[2] = { 0x00, 0x00 };
+        data = status;
+        length = sizeof(status);
+    }
+
+    if (data == NULL) {
+        return false;
+    }
+
+    Endpoint_ClearSETUP();
+    Endpoint_Write_Control_Stream_LE(data, length);
+    Endpoint_ClearOUT();
+    ++counters.localControls;
+    return true;
+}
+
 bool EVENT_USB_Device_UnhandledControlRequest(void) {
 
+    if (localHid && AnswerHidRequest()) {
+        return true;
+    }
+
+    controlRequest = USB_ControlRequest;
+
     if (USB_ControlRequest.wLength > MAX_CONTROL_TRANSFER_SIZE) {
-        Serial_SendByte(E_TYPE_DEBUG);
-        Serial_SendByte(sizeof(USB_ControlRequest));
-        Serial_SendData(&USB_ControlRequest, sizeof(USB_ControlRequest));
+        controlState = CONTROL_DEBUG;
         return false;
     }
 
-    controlReply = 0;
-    controlStall = 0;
+    Endpoint_ClearSETUP();
 
-    if (USB_ControlRequest.bmRequestType & REQDIR_DEVICETOHOST) {
-        send_control_header();
-    } else {
-        static uint8_t buffer[MAX_CONTROL_TRANSFER_SIZE];
-        Endpoint_ClearSETUP();
-        uint8_t ErrorCode =  Endpoint_Read_Control_Stream_LE(buffer, USB_ControlRequest.wLength);
+    if (!(USB_ControlRequest.bmRequestType & REQDIR_DEVICETOHOST)) {
+        // the reply can't arrive before the data is forwarded: share the buffer
+        uint8_t ErrorCode =  Endpoint_Read_Control_Stream_LE(control, USB_ControlRequest.wLength);
         if (ErrorCode != ENDPOINT_RWSTREAM_NoError) {
             Endpoint_StallTransaction();
             return true;
         }
+    }
+
+    controlState = CONTROL_FORWARD;
+
+    return true;
+}
+
+#if defined(INTERRUPT_CONTROL_ENDPOINT)
+#define CONTROL_INTERRUPT_DISABLE() (UEIENX &= ~(1 << RXSTPE))
+#define CONTROL_INTERRUPT_ENABLE() (UEIENX |= (1 << RXSTPE))
+#else
+#define CONTROL_INTERRUPT_DISABLE()
+#define CONTROL_INTERRUPT_ENABLE()
+#endif
+
+/*
+ * Relay the control requests without blocking the endpoint servicing.
+ */
+void ControlTask(void) {
+
+    switch (controlState) {
+    case CONTROL_IDLE:
+        return;
+    case CONTROL_DEBUG:
+        {
+            uint8_t header[2] = { E_TYPE_DEBUG, sizeof(controlRequest) };
+            Serial_QueueData(header, sizeof(header));
+            Serial_QueueData(&controlRequest, sizeof(controlRequest));
+        }
+        controlState = CONTROL_IDLE;
+        return;
+    case CONTROL_FORWARD:
+        controlReply = 0;
+        controlStall = 0;
         send_control_header();
-        Serial_SendData(buffer, USB_ControlRequest.wLength);
+        if (!(controlRequest.bmRequestType & REQDIR_DEVICETOHOST)) {
+            Serial_QueueData(control, controlRequest.wLength);
+        }
+        controlStart = TCNT1;
+        controlState = CONTROL_WAIT;
+        ++counters.controlRelayed;
+        return;
+    case CONTROL_WAIT:
+        if (!controlReply && (uint16_t)(TCNT1 - controlStart) < CONTROL_TIMEOUT) {
+            return;
+        }
+        break;
     }
 
-    TCNT1 = 0;
-    while (!controlReply && TCNT1 < 3125) {} // wait up to 50 ms
+    uint8_t PrevSelectedEndpoint = Endpoint_GetCurrentEndpoint();
+
+    Endpoint_SelectEndpoint(ENDPOINT_CONTROLEP);
+
+    CONTROL_INTERRUPT_DISABLE();
+
+    if (controlState == CONTROL_WAIT && !Endpoint_IsSETUPReceived()) {
 
-    if (!controlReply) {
-      Endpoint_ClearSETUP();
-      Endpoint_ClearStatusStage();
-      return true;
+        if (!controlReply) {
+            ++counters.controlTimeouts;
+        }
+
+        if (controlReply && controlStall) {
+            Endpoint_StallTransaction();
+        } else if (controlRequest.bmRequestType & REQDIR_DEVICETOHOST) {
+            // on timeout, complete the transfer without data
+            Endpoint_Write_Control_Stream_LE(control, controlReply ? controlReplyLen : 0);
+            Endpoint_ClearOUT();
+        } else {
+            Endpoint_ClearIN();
+        }
     }
 
-    if (controlStall) {
-        Endpoint_ClearSETUP();
-        Endpoint_StallTransaction();
-        return true;
+    controlState = CONTROL_IDLE;
+
+    CONTROL_INTERRUPT_ENABLE();
+
+    Endpoint_SelectEndpoint(PrevSelectedEndpoint);
+}
+
+static inline struct inCacheEntry * getInCache(uint8_t endpoint) {
+
+    uint8_t i;
+    for (i = 0; i < MAX_CACHED_IN && inCache[i].endpoint; ++i) {
+        if (inCache[i].endpoint == endpoint) {
+            return inCache + i;
+        }
     }
+    return NULL;
+}
+
+/*
+ * Answer the polls from the cached reports while the host has nothing new.
+ * The endpoint must be selected.
+ */
+static inline void RefreshCachedInput(struct inCacheEntry * cache) {
+
+    // a single copy is pending, even with two banks
+    if (Endpoint_GetBusyBanks() == 0) {
+
+        if (cache->armed) {
+            ++counters.cachedPolls; // the previous copy was sent
+        }
+
+        Endpoint_Write_Stream_LE(cache->data, cache->length, NULL);
 
-    if(USB_ControlRequest.bmRequestType & REQDIR_DEVICETOHOST) {
-        Endpoint_ClearSETUP();
-        Endpoint_Write_Control_Stream_LE(control, controlReplyLen);
-        Endpoint_ClearOUT();
-    } else {
         Endpoint_ClearIN();
+
+        cache->armed = 1;
+
+        if (cache->endpoint == pollEndpoint) {
+            pollPending = 1;
+        }
     }
+}
 
-    return true;
+/*
+ * Record the time of the console poll that took the last report.
+ */
+static inline void WatchPoll(void) {
+
+    if (pollPending) {
+        Endpoint_SelectEndpoint(pollEndpoint);
+        if (Endpoint_GetBusyBanks() == 0) {
+            lastPoll = GetClock();
+            pollPending = 0;
+        }
+    }
 }
 
 void SendNextInput(void) {
 
-    if (input.endpoint) {
+    WatchPoll();
 
-        Endpoint_SelectEndpoint(input.endpoint);
+    uint8_t head = inQueueHead;
+
+    if (head != inQueueTail) {
+
+        uint8_t index = IN_QUEUE_INDEX(head);
+
+        struct inCacheEntry * cache = getInCache(inQueue[index].packet.endpoint);
+
+        Endpoint_SelectEndpoint(inQueue[index].packet.endpoint);
+
+        if (cache != NULL && cache->armed) {
+            if (Endpoint_GetBusyBanks()) {
+                // the bank holds an outdated copy: replace it
+                Endpoint_AbortPendingIN();
+            } else {
+                ++counters.cachedPolls;
+            }
+            cache->armed = 0;
+        }
 
         if (Endpoint_IsINReady()) {
 
-            Endpoint_Write_Stream_LE(input.data, inputDataLen, NULL);
+            Endpoint_Write_Stream_LE(inQueue[index].packet.data, inQueue[index].length, NULL);
 
             Endpoint_ClearIN();
 
-            input.endpoint = 0;
+            inTimes[inCredits] = GetClock();
+
+            pollEndpoint = inQueue[index].packet.endpoint;
+            pollPending = 1;
 
-            ack(E_TYPE_IN);
+            ++counters.inPackets;
+
+            if (cache != NULL) {
+                memcpy(cache->data, inQueue[index].packet.data, inQueue[index].length);
+                cache->length = inQueue[index].length;
+            }
+
+            inQueueHead = ++head;
+
+            ++inCredits;
+        }
+    } else {
+
+        uint8_t i;
+        for (i = 0; i < MAX_CACHED_IN && inCache[i].endpoint; ++i) {
+            if (inCache[i].length) {
+                Endpoint_SelectEndpoint(inCache[i].endpoint);
+                RefreshCachedInput(inCache + i);
+            }
         }
     }
+
+    /*
+     * Return the credits by batches, or as soon as the queue is empty.
+     */
+    if (inCredits >= IN_CREDIT_BATCH || (inCredits && head == inQueueTail)) {
+
+        s_inAck inAck = { .credits = inCredits };
+        memcpy(inAck.times, inTimes, inCredits * sizeof(*inTimes));
+        inAck.times[inCredits] = lastPoll;
+
+        Serial_QueueAck(E_TYPE_IN, &inAck, offsetof(s_inAck, times) + (inCredits + 1) * sizeof(*inTimes));
+
+        inCredits = 0;
+    }
 }
 
-void ReceiveNextOutput(void) {
-    if (outEndpointNumber > 0) {
-      LED_ON;
-        static struct {
-            struct {
-                uint8_t type;
-                uint8_t length;
-            } header;
-            s_endpointPacket value;
-        } packet = { .header.type = E_TYPE_OUT };
+/*
+ * Room left in the TX data ring.
+ */
+static inline uint8_t Serial_DataRoom(void) {
+    return TX_DATA_SIZE - (uint8_t)(txDataHead - txDataTail);
+}
 
-        s_endpointConfig * endpoint = endpoints + outEndpoints[selectedOutEndpoint++];
-        if (selectedOutEndpoint == outEndpointNumber) {
-            selectedOutEndpoint = 0;
+/*
+ * Forward the packet of an OUT endpoint, if it received one and its frame fits into the TX ring.
+ * Return 0 if the TX ring is too full, the packet then stays in the bank (the console gets NAKed).
+ */
+static uint8_t ReceiveOutput(const s_endpointConfig * endpoint) {
+
+    static struct {
+        struct {
+            uint8_t type;
+            uint8_t length;
+        } header;
+        s_endpointPacket value;
+    } packet = { .header.type = E_TYPE_OUT };
+
+    if (Serial_DataRoom() < sizeof(packet.header) + 1 + endpoint->size) {
+        return 0;
+    }
+
+    Endpoint_SelectEndpoint(endpoint->number);
+
+    if (Endpoint_IsOUTReceived()) {
+
+        uint16_t length = 0;
+
+        if (!Endpoint_IsReadWriteAllowed()) {
+            Endpoint_ClearOUT(); // zero-length packet
+        } else if (Endpoint_Read_Stream_LE(packet.value.data, endpoint->size, &length) == ENDPOINT_RWSTREAM_NoError) {
+            length = endpoint->size;
+            Endpoint_ClearOUT();
+        }
+        // else a short packet, that Endpoint_Read_Stream_LE already released (clearing again would drop the other bank)
+
+        if (length) {
+            ++counters.outPackets;
+            packet.value.endpoint = endpoint->number;
+            packet.header.length = length + 1;
+            Serial_QueueData(&packet, sizeof(packet.header) + packet.header.length);
         }
+    }
 
-        packet.value.endpoint = endpoint->number;
+    return 1;
+}
 
-        Endpoint_SelectEndpoint(endpoint->number);
+/*
+ * Drain all the OUT endpoints holding data, as long as the TX ring has room.
+ * The IN refill and the control relay are serviced between two endpoints.
+ * A pass stopped by a full TX ring resumes at the same endpoint.
+ */
+static void ReceiveOutputs(void) {
 
-        if (Endpoint_IsOUTReceived()) {
+    if (outEndpointNumber == 0) {
+        return;
+    }
 
-            uint16_t length = 0;
+    LED_ON;
 
-            if (Endpoint_IsReadWriteAllowed()) {
-                uint8_t ErrorCode = Endpoint_Read_Stream_LE(packet.value.data, endpoint->size, &length);
-                if (ErrorCode == ENDPOINT_RWSTREAM_NoError) {
-                    length = endpoint->size;
-                }
-            }
+    uint8_t i;
+    for (i = 0; i < outEndpointNumber; ++i) {
 
-            Endpoint_ClearOUT();
+        if (!ReceiveOutput(endpoints + outEndpoints[selectedOutEndpoint])) {
+            break;
+        }
 
-            if (length) {
-                packet.header.length = length + 1;
-                Serial_SendData(&packet, sizeof(packet.header) + packet.header.length);
-            }
+        if (++selectedOutEndpoint == outEndpointNumber) {
+            selectedOutEndpoint = 0;
+        }
+
+        ProcessSerial();
+        SendNextInput();
+        ControlTask();
+    }
+
+    LED_OFF;
+}
+
+/*
+ * Sample the NAK flags of the endpoints.
+ */
+void CountNaks(void) {
+
+    uint8_t i;
+    for (i = 0; i < sizeof(endpoints) / sizeof(*endpoints) && endpoints[i].number; ++i) {
+        Endpoint_SelectEndpoint(endpoints[i].number);
+        if (UEINTX & (1 << NAKINI)) {
+            UEINTX &= ~(1 << NAKINI);
+            ++counters.inNaks;
+        }
+        if (UEINTX & (1 << NAKOUTI)) {
+            UEINTX &= ~(1 << NAKOUTI);
+            ++counters.outNaks;
         }
-        LED_OFF;
     }
 }
 
+/*
+ * Extend the clock on each timer 1 overflow (about every second).
+ */
+void ClockTask(void) {
+
+    if (TIFR1 & (1 << TOV1)) {
+        TIFR1 = (1 << TOV1);
+        ++clockHigh;
+        countersDue = 1;
+    }
+}
+
+/*
+ * Report the counters about every second.
+ */
+void SendCounters(void) {
+
+    if (!countersDue) {
+        return;
+    }
+
+    countersDue = 0;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        counters.rxOverruns = rxOverruns;
+        counters.maxIsrTime = maxIsrTime;
+        maxIsrTime = 0;
+    }
+
+    uint8_t header[2] = { E_TYPE_COUNTERS, sizeof(counters) };
+    Serial_QueueData(header, sizeof(header));
+    Serial_QueueData(&counters, sizeof(counters));
+
+    counters.maxLoopTime = 0;
+}
+
+/*
+ * Service the endpoints by priority: the IN refill first, as the console may poll
+ * at any time, then the control relay, then the OUT endpoints.
+ */
 void ENDPOINT_Task(void) {
 
     if (USB_DeviceState != DEVICE_STATE_Configured) {
+        ControlTask();
         return;
     }
 
     SendNextInput();
 
-    ReceiveNextOutput();
+    ControlTask();
+
+    ReceiveOutputs();
+
+    CountNaks();
+
+    SendCounters();
+
+    if (configured) {
+        configured = 0;
+        ack(E_TYPE_CONFIGURED);
+    }
 }
 
 int main(void) {
 
     SetupHardware();
 
+    uint16_t loopStart = TCNT1;
+
     for (;;) {
+        uint16_t now = TCNT1;
+        uint16_t loopTime = now - loopStart;
+        if (loopTime > counters.maxLoopTime) {
+            counters.maxLoopTime = loopTime;
+        }
+        loopStart = now;
+        ++counters.loops;
+
+        ClockTask();
+        ProcessSerial();
         ENDPOINT_Task();
+#if !defined(INTERRUPT_CONTROL_ENDPOINT)
         USB_USBTask();
+#endif
     }
 }
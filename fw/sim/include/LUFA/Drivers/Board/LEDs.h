@@ -0,0 +1,6 @@
+#ifndef SIM_LUFA_LEDS_H_
+#define SIM_LUFA_LEDS_H_
+
+static inline void LEDs_Init(void) {}
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef SIM_LUFA_SERIAL_H_
+#define SIM_LUFA_SERIAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+static inline void Serial_Init(const uint32_t baudRate, const bool doubleSpeed) {}
+
+#endif
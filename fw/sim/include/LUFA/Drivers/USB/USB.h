@@ -0,0 +1,93 @@
+/*
+ * The subset of the LUFA device API used by emu.c, implemented by sim.c
+ * on top of a simple model of the endpoint banks.
+ */
+
+#ifndef SIM_LUFA_USB_H_
+#define SIM_LUFA_USB_H_
+
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t bmRequestType;
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} __attribute__((packed)) USB_Request_Header_t;
+
+extern USB_Request_Header_t USB_ControlRequest;
+extern volatile uint8_t USB_DeviceState;
+extern uint8_t USB_Device_ControlEndpointSize;
+
+enum {
+    DEVICE_STATE_Unattached,
+    DEVICE_STATE_Powered,
+    DEVICE_STATE_Default,
+    DEVICE_STATE_Addressed,
+    DEVICE_STATE_Configured,
+    DEVICE_STATE_Suspended,
+};
+
+enum { ENDPOINT_RWSTREAM_NoError, ENDPOINT_RWSTREAM_IncompleteTransfer };
+enum { ENDPOINT_RWCSTREAM_NoError };
+
+#define EP_TYPE_CONTROL 0
+#define EP_TYPE_ISOCHRONOUS 1
+#define EP_TYPE_BULK 2
+#define EP_TYPE_INTERRUPT 3
+
+#define ENDPOINT_DIR_MASK 0x80
+#define ENDPOINT_DIR_OUT 0x00
+#define ENDPOINT_DIR_IN 0x80
+#define ENDPOINT_EPNUM_MASK 0x0f
+#define ENDPOINT_CONTROLEP 0
+
+#define REQDIR_HOSTTODEVICE (0 << 7)
+#define REQDIR_DEVICETOHOST (1 << 7)
+#define REQTYPE_STANDARD (0 << 5)
+#define REQTYPE_CLASS (1 << 5)
+#define REQTYPE_VENDOR (2 << 5)
+#define REQREC_DEVICE 0
+#define REQREC_INTERFACE 1
+#define REQREC_ENDPOINT 2
+#define REQREC_OTHER 3
+
+#define REQ_GetStatus 0
+
+#define HID_REQ_GetReport 0x01
+#define HID_REQ_GetIdle 0x02
+#define HID_REQ_GetProtocol 0x03
+#define HID_REQ_SetReport 0x09
+#define HID_REQ_SetIdle 0x0A
+#define HID_REQ_SetProtocol 0x0B
+
+#define GlobalInterruptEnable() sei()
+
+void USB_Init(void);
+void USB_USBTask(void);
+
+bool Endpoint_ConfigureEndpoint(const uint8_t address, const uint8_t type, const uint16_t size, const uint8_t banks);
+void Endpoint_SelectEndpoint(const uint8_t address);
+uint8_t Endpoint_GetCurrentEndpoint(void);
+uint8_t Endpoint_GetBusyBanks(void);
+void Endpoint_AbortPendingIN(void);
+bool Endpoint_IsINReady(void);
+bool Endpoint_IsOUTReceived(void);
+bool Endpoint_IsSETUPReceived(void);
+bool Endpoint_IsReadWriteAllowed(void);
+void Endpoint_ClearIN(void);
+void Endpoint_ClearOUT(void);
+void Endpoint_ClearSETUP(void);
+void Endpoint_ClearStatusStage(void);
+void Endpoint_StallTransaction(void);
+uint8_t Endpoint_Write_Stream_LE(const void * buffer, uint16_t length, uint16_t * bytesProcessed);
+uint8_t Endpoint_Read_Stream_LE(void * buffer, uint16_t length, uint16_t * bytesProcessed);
+uint8_t Endpoint_Write_Control_Stream_LE(const void * buffer, uint16_t length);
+uint8_t Endpoint_Read_Control_Stream_LE(void * buffer, uint16_t length);
+
+uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue, const uint16_t wIndex, const void ** const descriptorAddress);
+
+#endif
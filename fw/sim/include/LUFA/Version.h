@@ -0,0 +1,6 @@
+#ifndef SIM_LUFA_VERSION_H_
+#define SIM_LUFA_VERSION_H_
+
+#define LUFA_VERSION_STRING "sim"
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * The EEMEM variables are gathered in the sim_eeprom section,
+ * which sim.c saves to a file on each update.
+ */
+
+#ifndef SIM_AVR_EEPROM_H_
+#define SIM_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EEMEM __attribute__((section("sim_eeprom")))
+
+void eeprom_read_block(void * dst, const void * src, size_t size);
+void eeprom_update_block(const void * src, void * dst, size_t size);
+void eeprom_update_dword(uint32_t * dst, uint32_t value);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+void cli(void);
+void sei(void);
+
+/*
+ * The simulated interrupts run at the poll points of the main,
+ * a busy wait on an interrupt is one of them.
+ */
+void sim_poll(void);
+
+#define WAIT_INTERRUPT() sim_poll()
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Simulated atmega32u4 registers, see sim.c.
+ * The registers with side effects are accessed through functions.
+ */
+
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern volatile uint8_t DDRB, PORTB, DDRD, PORTD;
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t UCSR1A, UCSR1B;
+extern volatile uint16_t UDR1; // SIM_UDR_EMPTY until the UDRE interrupt writes it
+extern volatile uint8_t TCCR0B, TCCR1B, TIMSK1, UEIENX;
+
+#define SIM_UDR_EMPTY 0x100
+
+volatile uint8_t * sim_tcnt0(void);
+volatile uint16_t * sim_tcnt1(void);
+volatile uint16_t * sim_tifr1(void);
+volatile uint8_t * sim_ueintx(void);
+
+#define TCNT0 (*sim_tcnt0())
+#define TCNT1 (*sim_tcnt1())
+#define TIFR1 (*sim_tifr1())
+#define UEINTX (*sim_ueintx())
+
+#define RXCIE1 7
+#define UDRIE1 5
+#define DOR1 3
+
+#define CS01 1
+#define CS12 2
+#define TOV1 0
+
+#define NAKINI 6
+#define NAKOUTI 4
+#define RXSTPE 3
+
+#define ISR(VECTOR) void VECTOR(void)
+
+void USART1_RX_vect(void);
+void USART1_UDRE_vect(void);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef SIM_AVR_POWER_H_
+#define SIM_AVR_POWER_H_
+
+#define clock_div_1 0
+
+static inline void clock_prescale_set(int div) {}
+
+#endif
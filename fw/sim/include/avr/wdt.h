@@ -0,0 +1,9 @@
+#ifndef SIM_AVR_WDT_H_
+#define SIM_AVR_WDT_H_
+
+#define WDTO_15MS 0
+
+void wdt_enable(int timeout); // restarts the simulator
+void wdt_disable(void);
+
+#endif
@@ -0,0 +1,19 @@
+/*
+ * The interrupts only run at the poll points of the main (see sim.c),
+ * an atomic block masks them as on the AVR.
+ */
+
+#ifndef SIM_UTIL_ATOMIC_H_
+#define SIM_UTIL_ATOMIC_H_
+
+#include <stdint.h>
+
+uint8_t sim_save_cli(void);
+void sim_restore(uint8_t state);
+
+#define ATOMIC_RESTORESTATE
+
+#define ATOMIC_BLOCK(TYPE) \
+    for (uint8_t atomicState = sim_save_cli(), atomicDone = 0; !atomicDone; sim_restore(atomicState), atomicDone = 1)
+
+#endif
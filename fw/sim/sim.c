@@ -0,0 +1,827 @@
+/*
+ * Host build of emu.c.
+ *
+ * The serial port of the atmega32u4 is the master side of a pty,
+ * usbxtract opens the slave side. The firmware main runs unchanged, and the
+ * serial interrupts and a console polling the endpoints run at its poll points:
+ * the timer 1 reads, USB_USBTask() and the busy waits on an interrupt. So the
+ * interrupts only preempt the main where the AVR could run them too, everything
+ * runs in one thread, and the build uses the optimization of the firmware.
+ *
+ * usage: emusim [-p poll period] [-o OUT period] [-s OUT length] [-d serial delay] [-j serial jitter]
+ *               [-l main loop stall] [-b baudrate] [-e EEPROM file]
+ *
+ * The periods and delays are in microseconds. The OUT packets are full unless
+ * a shorter length is given. The main loop stall is
+ * busy-waited once per millisecond. The control requests are not simulated.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <termios.h>
+
+#include "../emu.h"
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include "../../include/protocol.h"
+
+#define PRINT_ERROR_ERRNO(MESSAGE) fprintf(stderr, "emusim: %s failed: %s\n", MESSAGE, strerror(errno));
+
+static struct {
+    unsigned int pollPeriod;
+    unsigned int outPeriod;
+    unsigned int outLength;
+    unsigned int delay;
+    unsigned int jitter;
+    unsigned int loopStall;
+    unsigned int baudrate;
+    const char * eepromFile;
+} options = {
+    .pollPeriod = 1000,
+    .baudrate = USART_BAUDRATE,
+};
+
+static char ** savedArgv = NULL;
+static int master = -1;
+
+static uint8_t interrupts = 0;
+
+static struct timespec startTime;
+
+static uint64_t now_ns(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec - startTime.tv_sec) * 1000000000ull + ts.tv_nsec - startTime.tv_nsec;
+}
+
+static uint64_t now_us(void) {
+
+    return now_ns() / 1000;
+}
+
+uint8_t sim_save_cli(void) {
+
+    uint8_t state = interrupts;
+    interrupts = 0;
+    return state;
+}
+
+void sim_restore(uint8_t state) {
+
+    interrupts = state;
+}
+
+void cli(void) {
+
+    interrupts = 0;
+}
+
+void sei(void) {
+
+    interrupts = 1;
+}
+
+/*
+ * Registers.
+ */
+volatile uint8_t DDRB, PORTB, DDRD, PORTD;
+volatile uint8_t MCUSR;
+volatile uint8_t UCSR1A, UCSR1B;
+volatile uint16_t UDR1;
+volatile uint8_t TCCR0B, TCCR1B, TIMSK1, UEIENX;
+
+volatile uint8_t * sim_tcnt0(void) {
+
+    static volatile uint8_t tcnt0;
+    tcnt0 = now_ns() / 500; // FCPU/8
+    return &tcnt0;
+}
+
+volatile uint16_t * sim_tcnt1(void) {
+
+    sim_poll();
+
+    static volatile uint16_t tcnt1;
+    tcnt1 = now_us() / 16; // FCPU/256
+    return &tcnt1;
+}
+
+/*
+ * The flags are cleared by writing 1, so the register holds them twice:
+ * a write breaks the pattern, and is applied on the next access.
+ * Only accessed by the main.
+ */
+volatile uint16_t * sim_tifr1(void) {
+
+    static volatile uint16_t tifr1 = 0;
+    static uint8_t flags = 0;
+    static uint64_t overflows = 0;
+
+    if (tifr1 != ((flags << 8) | flags)) {
+        flags &= ~(tifr1 & 0xff);
+    }
+
+    uint64_t count = (now_us() / 16) >> 16;
+    if (count != overflows) {
+        overflows = count;
+        flags |= (1 << TOV1);
+    }
+
+    tifr1 = (flags << 8) | flags;
+    return &tifr1;
+}
+
+/*
+ * EEPROM: the EEMEM variables, saved to options.eepromFile.
+ */
+extern char __start_sim_eeprom[];
+extern char __stop_sim_eeprom[];
+
+static void eeprom_load(void) {
+
+    memset(__start_sim_eeprom, 0xff, __stop_sim_eeprom - __start_sim_eeprom);
+
+    if (options.eepromFile == NULL) {
+        return;
+    }
+
+    FILE * file = fopen(options.eepromFile, "rb");
+    if (file != NULL) {
+        if (fread(__start_sim_eeprom, 1, __stop_sim_eeprom - __start_sim_eeprom, file) == 0) {
+            fprintf(stderr, "emusim: %s is empty\n", options.eepromFile);
+        }
+        fclose(file);
+    }
+}
+
+static void eeprom_save(void) {
+
+    if (options.eepromFile == NULL) {
+        return;
+    }
+
+    FILE * file = fopen(options.eepromFile, "wb");
+    if (file == NULL) {
+        PRINT_ERROR_ERRNO("fopen")
+        return;
+    }
+    fwrite(__start_sim_eeprom, 1, __stop_sim_eeprom - __start_sim_eeprom, file);
+    fclose(file);
+}
+
+void eeprom_read_block(void * dst, const void * src, size_t size) {
+
+    memcpy(dst, src, size);
+}
+
+void eeprom_update_block(const void * src, void * dst, size_t size) {
+
+    memcpy(dst, src, size);
+    eeprom_save();
+}
+
+void eeprom_update_dword(uint32_t * dst, uint32_t value) {
+
+    memcpy(dst, &value, sizeof(value));
+    eeprom_save();
+}
+
+/*
+ * The watchdog reset restarts the simulator on the same pty.
+ */
+void wdt_enable(int timeout) {
+
+    char fd[16];
+    snprintf(fd, sizeof(fd), "%d", master);
+    setenv("EMUSIM_PTY", fd, 1);
+
+    fprintf(stderr, "emusim: reset\n");
+    execv("/proc/self/exe", savedArgv);
+    PRINT_ERROR_ERRNO("execv")
+    exit(-1);
+}
+
+void wdt_disable(void) {
+
+}
+
+/*
+ * Endpoints: each one has up to two banks.
+ * The IN banks are filled by the firmware and emptied by the console polls,
+ * the OUT banks the other way round.
+ */
+#define SIM_ENDPOINTS 7
+
+static struct {
+    uint8_t address;
+    uint8_t size;
+    uint8_t banks; // 0 means not configured
+    volatile uint8_t ueintx;
+    uint8_t busy;
+    uint8_t head;
+    struct {
+        uint8_t data[MAX_PAYLOAD_SIZE_EP];
+        uint8_t length;
+        uint8_t read; // OUT: bytes already read by the firmware
+        uint64_t time; // IN: when the firmware released the bank
+    } bank[2];
+    uint8_t write[MAX_PAYLOAD_SIZE_EP]; // IN: bank being filled by the firmware
+    uint8_t writeLength;
+    uint8_t last[MAX_PAYLOAD_SIZE_EP]; // IN: last report taken by the console
+    uint8_t lastLength;
+} endpoints[SIM_ENDPOINTS];
+
+static uint8_t selected = 0;
+
+#define SELECTED (endpoints + selected)
+#define BANK(EP, INDEX) ((EP)->bank + (((EP)->head + (INDEX)) & 1))
+
+USB_Request_Header_t USB_ControlRequest;
+volatile uint8_t USB_DeviceState = DEVICE_STATE_Unattached;
+uint8_t USB_Device_ControlEndpointSize = MAX_PACKET_SIZE_EP0;
+
+volatile uint8_t * sim_ueintx(void) {
+
+    return &SELECTED->ueintx;
+}
+
+bool Endpoint_ConfigureEndpoint(const uint8_t address, const uint8_t type, const uint16_t size, const uint8_t banks) {
+
+    memset(endpoints + (address & ENDPOINT_EPNUM_MASK), 0x00, sizeof(*endpoints));
+    endpoints[address & ENDPOINT_EPNUM_MASK].address = address;
+    endpoints[address & ENDPOINT_EPNUM_MASK].size = size;
+    endpoints[address & ENDPOINT_EPNUM_MASK].banks = banks;
+    return true;
+}
+
+void Endpoint_SelectEndpoint(const uint8_t address) {
+
+    selected = address & ENDPOINT_EPNUM_MASK;
+}
+
+uint8_t Endpoint_GetCurrentEndpoint(void) {
+
+    return selected | (SELECTED->address & ENDPOINT_DIR_MASK);
+}
+
+uint8_t Endpoint_GetBusyBanks(void) {
+
+    return SELECTED->busy;
+}
+
+void Endpoint_AbortPendingIN(void) {
+
+    SELECTED->busy = 0;
+}
+
+bool Endpoint_IsINReady(void) {
+
+    return SELECTED->busy < SELECTED->banks;
+}
+
+bool Endpoint_IsOUTReceived(void) {
+
+    return SELECTED->busy > 0;
+}
+
+bool Endpoint_IsReadWriteAllowed(void) {
+
+    return SELECTED->busy > 0 && BANK(SELECTED, 0)->read < BANK(SELECTED, 0)->length;
+}
+
+uint8_t Endpoint_Write_Stream_LE(const void * buffer, uint16_t length, uint16_t * bytesProcessed) {
+
+    if (length > sizeof(SELECTED->write) - SELECTED->writeLength) {
+        length = sizeof(SELECTED->write) - SELECTED->writeLength;
+    }
+    memcpy(SELECTED->write + SELECTED->writeLength, buffer, length);
+    SELECTED->writeLength += length;
+    if (bytesProcessed != NULL) {
+        *bytesProcessed += length;
+    }
+    return ENDPOINT_RWSTREAM_NoError;
+}
+
+void Endpoint_ClearIN(void) {
+
+    if (SELECTED->busy < SELECTED->banks) {
+        memcpy(BANK(SELECTED, SELECTED->busy)->data, SELECTED->write, SELECTED->writeLength);
+        BANK(SELECTED, SELECTED->busy)->length = SELECTED->writeLength;
+        BANK(SELECTED, SELECTED->busy)->time = now_us();
+        ++SELECTED->busy;
+    }
+    SELECTED->writeLength = 0;
+}
+
+uint8_t Endpoint_Read_Stream_LE(void * buffer, uint16_t length, uint16_t * bytesProcessed) {
+
+    uint16_t count = 0;
+    if (SELECTED->busy > 0) {
+        count = BANK(SELECTED, 0)->length - BANK(SELECTED, 0)->read;
+        if (count > length) {
+            count = length;
+        }
+        memcpy(buffer, BANK(SELECTED, 0)->data + BANK(SELECTED, 0)->read, count);
+        BANK(SELECTED, 0)->read += count;
+    }
+    if (bytesProcessed != NULL) {
+        *bytesProcessed += count;
+    }
+    if (count < length) {
+        Endpoint_ClearOUT(); // LUFA releases a bank it has read out before the end of the stream
+        return ENDPOINT_RWSTREAM_IncompleteTransfer;
+    }
+    return ENDPOINT_RWSTREAM_NoError;
+}
+
+void Endpoint_ClearOUT(void) {
+
+    if (SELECTED->busy > 0) {
+        SELECTED->head ^= 1;
+        --SELECTED->busy;
+    }
+}
+
+bool Endpoint_IsSETUPReceived(void) {
+
+    return false;
+}
+
+void Endpoint_ClearSETUP(void) {
+
+}
+
+void Endpoint_ClearStatusStage(void) {
+
+}
+
+void Endpoint_StallTransaction(void) {
+
+}
+
+uint8_t Endpoint_Write_Control_Stream_LE(const void * buffer, uint16_t length) {
+
+    return ENDPOINT_RWCSTREAM_NoError;
+}
+
+uint8_t Endpoint_Read_Control_Stream_LE(void * buffer, uint16_t length) {
+
+    return ENDPOINT_RWCSTREAM_NoError;
+}
+
+/*
+ * The console enumerates the device 10 ms after USB_Init,
+ * and only reads its device and configuration descriptors.
+ */
+static uint64_t attachTime = 0;
+
+void USB_Init(void) {
+
+    attachTime = now_us() + 10000;
+}
+
+static void enumerate(void) {
+
+    const uint8_t * device = NULL;
+    if (CALLBACK_USB_GetDescriptor(0x0100, 0, (const void **)&device) < 18) {
+        fprintf(stderr, "emusim: no device descriptor\n");
+        exit(-1);
+    }
+    USB_Device_ControlEndpointSize = device[7];
+
+    const uint8_t * config = NULL;
+    uint16_t length = CALLBACK_USB_GetDescriptor(0x0200, 0, (const void **)&config);
+
+    fprintf(stderr, "emusim: enumerated VID 0x%02x%02x PID 0x%02x%02x, configuration %u bytes\n",
+            device[9], device[8], device[11], device[10], length);
+
+    EVENT_USB_Device_ConfigurationChanged();
+
+    USB_DeviceState = DEVICE_STATE_Configured;
+}
+
+void USB_USBTask(void) {
+
+    static uint64_t nextStall = 0;
+
+    sim_poll();
+
+    uint64_t now = now_us();
+
+    if (attachTime && now >= attachTime) {
+        attachTime = 0;
+        enumerate();
+    }
+
+    if (options.loopStall && now >= nextStall) {
+        nextStall = now + 1000;
+        // the interrupts still run
+        while (now_us() < now + options.loopStall) {
+            sim_poll();
+        }
+    }
+}
+
+/*
+ * Serial link: each direction is delayed by options.delay plus a random
+ * jitter, keeping the byte order, and paced at options.baudrate.
+ */
+#define SIM_SERIAL_QUEUE 65536
+
+typedef struct {
+    uint8_t data[SIM_SERIAL_QUEUE];
+    uint64_t due[SIM_SERIAL_QUEUE];
+    uint16_t head;
+    uint16_t tail;
+    uint64_t lastDue;
+} s_serialQueue;
+
+static s_serialQueue toFirmware;
+
+/*
+ * The last IN reports sent by the host, to tell how old a report is when the console takes it:
+ * its age is the time since the host sent it, and it is behind by the reports the host sent after it.
+ */
+#define SIM_IN_FRAMES 64
+
+static struct {
+    uint8_t state; // 0: type, 1: length, 2: value
+    uint8_t type;
+    uint8_t length;
+    uint8_t count;
+    uint8_t value[UINT8_MAX];
+} hostFrame;
+
+static struct {
+    uint64_t time;
+    uint32_t seq;
+    uint8_t length;
+    s_endpointPacket packet;
+} inFrames[SIM_IN_FRAMES];
+
+static uint32_t inFramesSent = 0;
+
+static void parse_host_byte(uint8_t byte, uint64_t now) {
+
+    switch (hostFrame.state) {
+    case 0:
+        hostFrame.type = byte;
+        hostFrame.state = 1;
+        return;
+    case 1:
+        hostFrame.length = byte;
+        hostFrame.count = 0;
+        hostFrame.state = 2;
+        break;
+    default:
+        hostFrame.value[hostFrame.count++] = byte;
+        break;
+    }
+    if (hostFrame.count < hostFrame.length) {
+        return;
+    }
+    hostFrame.state = 0;
+    if (hostFrame.type == E_TYPE_IN && hostFrame.length > 0 && hostFrame.length <= sizeof(s_endpointPacket)) {
+        typeof(*inFrames) * frame = inFrames + inFramesSent % SIM_IN_FRAMES;
+        frame->time = now;
+        frame->seq = inFramesSent++;
+        frame->length = hostFrame.length - 1;
+        memcpy(&frame->packet, hostFrame.value, hostFrame.length);
+    }
+}
+
+/*
+ * Find the newest report sent by the host with this content.
+ */
+static const typeof(*inFrames) * find_in_frame(uint8_t address, const uint8_t * data, uint8_t length) {
+
+    uint32_t count = inFramesSent < SIM_IN_FRAMES ? inFramesSent : SIM_IN_FRAMES;
+    uint32_t i;
+    for (i = 1; i <= count; ++i) {
+        const typeof(*inFrames) * frame = inFrames + (inFramesSent - i) % SIM_IN_FRAMES;
+        if ((frame->packet.endpoint & ENDPOINT_EPNUM_MASK) == (address & ENDPOINT_EPNUM_MASK)
+                && frame->length == length && !memcmp(frame->packet.data, data, length)) {
+            return frame;
+        }
+    }
+    return NULL;
+}
+static s_serialQueue toHost;
+
+static uint64_t byteTime; // us per byte, 10 bits
+static uint64_t nextRx = 0;
+static uint64_t nextTx = 0;
+
+static int serial_push(s_serialQueue * queue, uint8_t byte, uint64_t now) {
+
+    if ((uint16_t)(queue->tail + 1) == queue->head) {
+        return -1;
+    }
+    uint64_t due = now + options.delay + (options.jitter ? rand() % (options.jitter + 1) : 0);
+    if (due < queue->lastDue) {
+        due = queue->lastDue;
+    }
+    queue->lastDue = due;
+    queue->data[queue->tail] = byte;
+    queue->due[queue->tail] = due;
+    ++queue->tail;
+    return 0;
+}
+
+static void serial_task(uint64_t now) {
+
+    uint8_t buffer[256];
+
+    ssize_t count = read(master, buffer, sizeof(buffer));
+    ssize_t i;
+    for (i = 0; i < count; ++i) {
+        parse_host_byte(buffer[i], now);
+        if (serial_push(&toFirmware, buffer[i], now) < 0) {
+            fprintf(stderr, "emusim: serial queue full\n");
+        }
+    }
+
+    if (interrupts) {
+
+        if (nextRx + byteTime < now) {
+            nextRx = now; // idle line
+        }
+        while (toFirmware.head != toFirmware.tail && toFirmware.due[toFirmware.head] <= now && nextRx <= now) {
+            UDR1 = toFirmware.data[toFirmware.head++];
+            USART1_RX_vect();
+            nextRx += byteTime;
+        }
+
+        if (nextTx + byteTime < now) {
+            nextTx = now;
+        }
+        while ((UCSR1B & (1 << UDRIE1)) && nextTx <= now) {
+            UDR1 = SIM_UDR_EMPTY;
+            USART1_UDRE_vect();
+            if (UDR1 == SIM_UDR_EMPTY) {
+                break;
+            }
+            serial_push(&toHost, UDR1, now);
+            nextTx += byteTime;
+        }
+    }
+
+    count = 0;
+    while (toHost.head != toHost.tail && toHost.due[toHost.head] <= now && count < (ssize_t)sizeof(buffer)) {
+        buffer[count++] = toHost.data[toHost.head++];
+    }
+    if (count > 0 && write(master, buffer, count) != count) {
+        PRINT_ERROR_ERRNO("write")
+    }
+}
+
+/*
+ * Console: polls the IN endpoints every options.pollPeriod,
+ * and sends OUT packets every options.outPeriod.
+ */
+static struct {
+    unsigned int polls;
+    unsigned int unchanged; // same report as the previous poll
+    unsigned int naks;
+    uint64_t waitSum; // time the reports spent in the banks
+    uint64_t waitMax;
+    unsigned int aged; // reports found among the last ones sent by the host
+    uint64_t ageSum; // time since the host sent the reports
+    uint64_t ageMax;
+    uint32_t behindMax; // newer reports the host had sent
+    unsigned int outPackets;
+    unsigned int outNaks;
+} stats;
+
+static void console_task(uint64_t now) {
+
+    static uint64_t nextPoll = 0;
+    static uint64_t nextOut = 0;
+    static uint8_t outPattern = 0;
+
+    if (USB_DeviceState != DEVICE_STATE_Configured) {
+        nextPoll = nextOut = now;
+        return;
+    }
+
+    uint8_t poll = now >= nextPoll;
+    if (poll) {
+        nextPoll += options.pollPeriod;
+        if (nextPoll <= now) {
+            nextPoll = now + options.pollPeriod; // late
+        }
+    }
+
+    uint8_t out = options.outPeriod && now >= nextOut;
+    if (out) {
+        nextOut += options.outPeriod;
+        if (nextOut <= now) {
+            nextOut = now + options.outPeriod;
+        }
+    }
+
+    unsigned int i;
+    for (i = 1; i < SIM_ENDPOINTS; ++i) {
+
+        typeof(*endpoints) * ep = endpoints + i;
+
+        if (!ep->banks) {
+            continue;
+        }
+
+        if ((ep->address & ENDPOINT_DIR_MASK) == ENDPOINT_DIR_IN) {
+            if (!poll) {
+                continue;
+            }
+            if (ep->busy) {
+                ++stats.polls;
+                // the firmware may release a bank after now was sampled
+                uint64_t wait = now > BANK(ep, 0)->time ? now - BANK(ep, 0)->time : 0;
+                stats.waitSum += wait;
+                if (wait > stats.waitMax) {
+                    stats.waitMax = wait;
+                }
+                const typeof(*inFrames) * frame = find_in_frame(ep->address, BANK(ep, 0)->data, BANK(ep, 0)->length);
+                if (frame != NULL) {
+                    ++stats.aged;
+                    stats.ageSum += now - frame->time;
+                    if (now - frame->time > stats.ageMax) {
+                        stats.ageMax = now - frame->time;
+                    }
+                    if (inFramesSent - 1 - frame->seq > stats.behindMax) {
+                        stats.behindMax = inFramesSent - 1 - frame->seq;
+                    }
+                }
+                if (ep->lastLength == BANK(ep, 0)->length && !memcmp(ep->last, BANK(ep, 0)->data, ep->lastLength)) {
+                    ++stats.unchanged;
+                }
+                memcpy(ep->last, BANK(ep, 0)->data, BANK(ep, 0)->length);
+                ep->lastLength = BANK(ep, 0)->length;
+                ep->head ^= 1;
+                --ep->busy;
+            } else {
+                ep->ueintx |= (1 << NAKINI);
+                ++stats.naks;
+            }
+        } else if (out) {
+            if (ep->busy < ep->banks) {
+                uint8_t length = (options.outLength && options.outLength < ep->size) ? options.outLength : ep->size;
+                memset(BANK(ep, ep->busy)->data, outPattern++, length);
+                BANK(ep, ep->busy)->length = length;
+                BANK(ep, ep->busy)->read = 0;
+                ++ep->busy;
+                ++stats.outPackets;
+            } else {
+                ep->ueintx |= (1 << NAKOUTI);
+                ++stats.outNaks;
+            }
+        }
+    }
+}
+
+static void print_stats(void) {
+
+    fprintf(stderr, "emusim: polls %u (%u unchanged, %u NAK), bank wait avg %llu max %llu us,"
+            " report age avg %llu max %llu us (up to %u behind) | OUT %u (%u NAK)\n",
+            stats.polls, stats.unchanged, stats.naks,
+            stats.polls ? (unsigned long long)(stats.waitSum / stats.polls) : 0, (unsigned long long)stats.waitMax,
+            stats.aged ? (unsigned long long)(stats.ageSum / stats.aged) : 0, (unsigned long long)stats.ageMax, stats.behindMax,
+            stats.outPackets, stats.outNaks);
+    memset(&stats, 0x00, sizeof(stats));
+}
+
+/*
+ * Run the serial link and the console, with the interrupts they raise.
+ * An interrupt reading a timer doesn't run the hardware again.
+ */
+void sim_poll(void) {
+
+    static uint8_t polling = 0;
+    static uint64_t lastPoll = 0;
+    static uint64_t nextStats = 1000000;
+
+    uint64_t now = now_us();
+
+    if (polling || now == lastPoll) {
+        return;
+    }
+    polling = 1;
+    lastPoll = now;
+
+    serial_task(now);
+    console_task(now);
+
+    if (now >= nextStats) {
+        nextStats += 1000000;
+        if (USB_DeviceState == DEVICE_STATE_Configured) {
+            print_stats();
+        }
+    }
+
+    polling = 0;
+}
+
+static int open_pty(void) {
+
+    const char * inherited = getenv("EMUSIM_PTY");
+    if (inherited != NULL) {
+        master = atoi(inherited);
+        return 0;
+    }
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+        PRINT_ERROR_ERRNO("posix_openpt")
+        return -1;
+    }
+
+    const char * path = ptsname(master);
+
+    // keep the slave open in raw mode, so the line discipline doesn't echo
+    // and the master doesn't get EIO while usbxtract is not running
+    int slave = open(path, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        PRINT_ERROR_ERRNO("open")
+        return -1;
+    }
+    struct termios tios;
+    tcgetattr(slave, &tios);
+    cfmakeraw(&tios);
+    tcsetattr(slave, TCSANOW, &tios);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    printf("emusim: serial port is %s\n", path);
+    fflush(stdout);
+
+    return 0;
+}
+
+static void usage(void) {
+
+    fprintf(stderr, "usage: emusim [-p poll period] [-o OUT period] [-s OUT length] [-d serial delay] [-j serial jitter]"
+            " [-l main loop stall] [-b baudrate] [-e EEPROM file]\n");
+}
+
+/*
+ * Runs before the main of emu.c.
+ */
+__attribute__((constructor)) static void sim_init(int argc, char * argv[]) {
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+    savedArgv = argv;
+
+    int c;
+    while ((c = getopt(argc, argv, "p:o:s:d:j:l:b:e:h")) != -1) {
+        switch (c) {
+        case 'p':
+            options.pollPeriod = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            options.outPeriod = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            options.outLength = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            options.delay = strtoul(optarg, NULL, 0);
+            break;
+        case 'j':
+            options.jitter = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            options.loopStall = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            options.baudrate = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            options.eepromFile = optarg;
+            break;
+        default:
+            usage();
+            exit(c == 'h' ? 0 : -1);
+        }
+    }
+
+    if (options.pollPeriod == 0 || options.baudrate == 0) {
+        usage();
+        exit(-1);
+    }
+
+    byteTime = 10 * 1000000 / options.baudrate;
+
+    eeprom_load();
+
+    if (open_pty() < 0) {
+        exit(-1);
+    }
+}
@@ -22,6 +22,9 @@
 
 #define MAX_DESCRIPTORS 32 // should not exceed 255
 
+// the descriptors and their index are kept in the 1Kbyte EEPROM
+#define MAX_STORED_CONFIG_SIZE (1024 - 8)
+
 // the atmega32u4 supports up to 6 non-control endpoints
 #define MAX_ENDPOINTS 6
 
@@ -29,6 +32,24 @@
 
 #define MAX_PAYLOAD_SIZE_EP 64 // for non-control endpoints
 
+// number of IN packets the atmega32u4 can buffer (should be a power of 2)
+// the host may have up to IN_QUEUE_SIZE IN packets in flight
+#define IN_QUEUE_SIZE 16
+
+// the atmega32u4 returns IN credits by batches of IN_CREDIT_BATCH
+#define IN_CREDIT_BATCH 2
+
+// resolution of the atmega32u4 clock (timer 1)
+// the atmega32u4 answers an empty ping frame with its clock (uint32_t)
+#define FW_CLOCK_TICK_US 16
+
+// the IN acks hold the number of credits, followed by the clock of each Endpoint_ClearIN,
+// and by the clock of the last console poll that took a report (only these times are sent)
+typedef struct PACKED {
+  uint8_t credits;
+  uint32_t times[IN_CREDIT_BATCH + 1];
+} s_inAck;
+
 typedef struct PACKED {
   uint16_t offset;
   uint16_t wValue;
@@ -36,10 +57,15 @@ typedef struct PACKED {
   uint16_t wLength;
 } s_descriptorIndex;
 
+// endpoint flags
+#define EP_FLAG_CACHED (1 << 0) // IN: the last report is kept and answers every poll
+#define EP_FLAG_DOUBLE_BANK (1 << 1) // use two banks if the DPRAM allows it
+
 typedef struct PACKED {
   uint8_t number; // 0 means end of table
   uint8_t type;
   uint8_t size;
+  uint8_t flags;
 } s_endpointConfig;
 
 typedef struct PACKED {
@@ -57,8 +83,73 @@ typedef enum {
   E_TYPE_IN,            //6
   E_TYPE_OUT,           //7
   E_TYPE_DEBUG,         //8
+  E_TYPE_COUNTERS,      //9
+  E_TYPE_CONFIGURED,    //10
+  E_TYPE_FEATURES,      //11
+  E_TYPE_PING,          //12
+  E_TYPE_HASH,          //13
 } e_packetType;
 
+/*
+ * The host starts with a hash frame (uint32_t) over the descriptors and
+ * index it would send. The atmega32u4 acks it with 1 if its stored
+ * descriptors have the same hash, and the host then skips their upload.
+ */
+#define CONFIG_HASH_INIT 2166136261u
+
+// FNV-1a
+static inline uint32_t config_hash(uint32_t hash, uint8_t byte) {
+  return (hash ^ byte) * 16777619u;
+}
+
+/*
+ * The descriptors, index and endpoints are streamed without waiting for acks.
+ * The atmega32u4 acks the endpoints with the checksum of all the bytes received.
+ */
+typedef struct PACKED {
+  uint8_t inSlots;
+  uint16_t checksum;
+} s_endpointsAck;
+
+// fletcher-like checksum, modulo 256
+static inline uint16_t config_checksum(uint16_t checksum, uint8_t byte) {
+  uint8_t sum1 = (checksum & 0xff) + byte;
+  uint8_t sum2 = (checksum >> 8) + sum1;
+  return (sum2 << 8) | sum1;
+}
+
+/*
+ * The atmega32u4 sends its counters about every second.
+ * The counts are cumulative, the max values are reset after each frame.
+ */
+typedef struct PACKED {
+  uint32_t loops; // main loop iterations
+  uint16_t maxLoopTime; // worst main loop iteration, in 16 us ticks
+  uint8_t maxIsrTime; // worst serial interrupt, in 0.5 us ticks
+  uint32_t inPackets; // IN reports received from the host and sent
+  uint32_t cachedPolls; // IN polls answered from the cached reports
+  uint32_t inNaks; // IN polls NAKed (sampled, at most one per main loop and endpoint)
+  uint32_t outPackets; // OUT packets forwarded to the host
+  uint32_t outNaks; // OUT transfers NAKed (sampled)
+  uint32_t controlRelayed; // control requests relayed to the host
+  uint32_t controlTimeouts; // relayed control requests without a reply
+  uint32_t localControls; // control requests answered by the atmega32u4
+  uint16_t rxOverruns; // bytes lost by the serial receiver
+} s_counters;
+
+/*
+ * A feature frame enables the local answers to the HID class requests,
+ * and appends its feature reports to the static ones.
+ * Each feature report is a s_featureHeader followed by the report data.
+ */
+#define MAX_FEATURES_SIZE 64
+
+typedef struct PACKED {
+  uint8_t reportId;
+  uint8_t interface;
+  uint8_t length;
+} s_featureHeader;
+
 #define BYTE_LEN_0_BYTE   0x00
 #define BYTE_LEN_1_BYTE   0x01
 
@@ -92,7 +92,7 @@ static int client_close ()
   return 1;
 }
 //
-static int client_send (s_packet *packet)
+static int client_send (const s_packet *packet)
 {
   int bs = 0;
   //dump adapter data
@@ -310,9 +310,6 @@ int adapter_send (int adapter, unsigned char type, const unsigned char * data, u
     }
     data += length;
     count -= length;
-    //store for network processing
-    memcpy (&cpkt, &packet, length + 2);
-    //
     int ret = gserial_write (adapters[adapter].serial, &packet, 2 + length);
     if(ret < 0) 
     {
@@ -324,12 +321,36 @@ int adapter_send (int adapter, unsigned char type, const unsigned char * data, u
       fflush (stdout);
     }
     //send to network for processing
-    client_send (&cpkt);
+    client_send (&packet);
   } while (count > 0);
 
   return 0;
 }
 
+/*
+ * Send a frame that is already formatted (header included), without copying it.
+ */
+int adapter_send_frame (int adapter, const s_packet * packet)
+{
+
+  ADAPTER_CHECK(adapter, -1)
+
+  int ret = gserial_write (adapters[adapter].serial, packet, sizeof(packet->header) + packet->header.length);
+  if(ret < 0) 
+  {
+    return -1;
+  }
+  if (adapterDbg & 0x0f)
+  {
+    fprintf (stdout, "\n#d:adapter sent %dB", ret);
+    fflush (stdout);
+  }
+  //send to network for processing
+  client_send (packet);
+
+  return 0;
+}
+
 int adapter_open(const char * port, ADAPTER_READ_CALLBACK fp_read, ADAPTER_WRITE_CALLBACK fp_write, ADAPTER_CLOSE_CALLBACK fp_close) 
 {
   extern int sbaud;
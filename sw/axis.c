@@ -0,0 +1,150 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#include <axis.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AXIS_INPUT_MAX 65535
+
+/*
+ * Map the 16-bit input range to [0, max], as get_cmap() does.
+ */
+long axis_linear(long x, long max) {
+
+  long rv = x * max / AXIS_INPUT_MAX;
+  if (rv > max) {
+    rv = max;
+  }
+  if (rv < 0) {
+    rv = 0;
+  }
+  return rv;
+}
+
+/*
+ * Shape a deflection in [0, 1].
+ */
+static double shape(const s_axisConfig * config, double v) {
+
+  v = v * 100 / config->range;
+
+  double deadzone = config->deadzone / 100.0;
+  double saturation = config->saturation / 100.0;
+  if (v <= deadzone) {
+    return 0;
+  }
+  v = (v - deadzone) / (saturation - deadzone);
+  if (v >= 1) {
+    return 1;
+  }
+
+  double curve = config->curve / 100.0;
+  return (1 - curve) * v + curve * v * v * v;
+}
+
+static int is_linear(const s_axisConfig * config) {
+
+  return config->deadzone == 0 && config->saturation == 100 && config->curve == 0 && config->range == 100;
+}
+
+/*
+ * Build the table of an output max unless it is built, in the first free table,
+ * else in place of the oldest one.
+ *
+ * \return the index of the table, -1 if it can't be allocated
+ */
+int axis_build(s_axis * axis, long max) {
+
+  unsigned int t;
+  for (t = 0; t < AXIS_MAX_TABLES && axis->tables[t].max != max; ++t) {}
+  if (t < AXIS_MAX_TABLES) {
+    return t;
+  }
+  for (t = 0; t < AXIS_MAX_TABLES && axis->tables[t].max != 0; ++t) {}
+  if (t == AXIS_MAX_TABLES) {
+    t = axis->next;
+    axis->next = (axis->next + 1) % AXIS_MAX_TABLES;
+  }
+  if (axis->tables[t].lut == NULL) {
+    axis->tables[t].lut = malloc((AXIS_INPUT_MAX + 1) * sizeof(*axis->tables[t].lut));
+    if (axis->tables[t].lut == NULL) {
+      fprintf(stderr, "%s:%d %s: can't allocate the table\n", __FILE__, __LINE__, __func__);
+      return -1;
+    }
+  }
+
+  unsigned int i;
+  for (i = 0; i <= AXIS_INPUT_MAX; ++i) {
+    long x = i;
+    if (!is_linear(&axis->config)) {
+      double shaped;
+      if (axis->centered) {
+        double c = (i - AXIS_INPUT_MAX / 2.0) / (AXIS_INPUT_MAX / 2.0);
+        shaped = c < 0 ? -shape(&axis->config, -c) : shape(&axis->config, c);
+        shaped = (shaped + 1) * AXIS_INPUT_MAX / 2.0;
+      } else if (axis->inverted) {
+        // the deflection is measured from the max
+        shaped = (1 - shape(&axis->config, (double)(AXIS_INPUT_MAX - i) / AXIS_INPUT_MAX)) * AXIS_INPUT_MAX;
+      } else {
+        shaped = shape(&axis->config, (double)i / AXIS_INPUT_MAX) * AXIS_INPUT_MAX;
+      }
+      x = shaped + 0.5;
+    }
+    axis->tables[t].lut[i] = axis_linear(x, max);
+  }
+  axis->tables[t].max = max;
+  return t;
+}
+
+/*
+ * Parse comma-separated shaping parameters, e.g. deadzone=2,saturation=95,curve=30,range=50
+ *
+ * \return 0 in case of success, -1 in case of error
+ */
+int axis_parse(s_axis * axis, const char * params) {
+
+  s_axisConfig config = axis->config;
+
+  while (*params) {
+    char name[16];
+    unsigned int value;
+    int length;
+    if (sscanf(params, "%15[a-z]=%u%n", name, &value, &length) < 2) {
+      return -1;
+    }
+    if (!strcmp(name, "deadzone") && value < 100) {
+      config.deadzone = value;
+    } else if (!strcmp(name, "saturation") && value > 0 && value <= 100) {
+      config.saturation = value;
+    } else if (!strcmp(name, "curve") && value <= 100) {
+      config.curve = value;
+    } else if (!strcmp(name, "range") && value > 0 && value <= 100) {
+      config.range = value;
+    } else {
+      return -1;
+    }
+    params += length;
+    if (*params == ',') {
+      ++params;
+    } else if (*params) {
+      return -1;
+    }
+  }
+
+  if (config.deadzone >= config.saturation) {
+    return -1;
+  }
+
+  axis->config = config;
+  // the tables are rebuilt when the converter is selected
+  unsigned int t;
+  for (t = 0; t < AXIS_MAX_TABLES; ++t) {
+    axis->tables[t].max = 0;
+  }
+
+  return 0;
+}
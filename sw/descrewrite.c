@@ -0,0 +1,287 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#include <descrewrite.h>
+#include <hidplan.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DT_CONFIG   0x02
+#define DT_ENDPOINT 0x05
+
+#define CONFIG_ATT_SELF_POWERED  0x40
+#define CONFIG_ATT_REMOTE_WAKEUP 0x20
+
+#define ENDPOINT_DIR_IN    0x80
+#define ENDPOINT_XFER_MASK 0x03
+#define ENDPOINT_XFER_INT  0x03
+
+/*
+ * Parse the overrides of a target, e.g. in:interval=1, in4:interval=1,size=32, config:power=100,selfpowered=0
+ * The targets are config, in, out (all the endpoints of a direction), in<number> and out<number>.
+ *
+ * \return 0 in case of success, -1 in case of error
+ */
+int descrewrite_parse(s_descRewrite * rewrite, const char * spec) {
+
+  char target[8];
+  unsigned int number = 0;
+  int length;
+  if (sscanf(spec, "%7[a-z]%n", target, &length) < 1) {
+    return -1;
+  }
+  spec += length;
+  if (*spec != ':' && sscanf(spec, "%u%n", &number, &length) == 1) {
+    spec += length;
+  }
+  if (*spec++ != ':') {
+    return -1;
+  }
+
+  int config = !strcmp(target, "config");
+  if (config ? number != 0 : ((strcmp(target, "in") && strcmp(target, "out")) || number > 15)) {
+    return -1;
+  }
+
+  s_descRewriteEndpoint endpoint = { 0 };
+  if (!config) {
+    endpoint = rewrite->endpoints[!strcmp(target, "in")][number];
+  }
+  uint8_t set = rewrite->set;
+  uint8_t power = rewrite->power;
+  uint8_t selfPowered = rewrite->selfPowered;
+  uint8_t remoteWakeup = rewrite->remoteWakeup;
+
+  while (*spec) {
+    char name[16];
+    unsigned int value;
+    if (sscanf(spec, "%15[a-z]=%u%n", name, &value, &length) < 2) {
+      return -1;
+    }
+    if (!config && !strcmp(name, "interval") && value > 0 && value <= 255) {
+      endpoint.set |= DESCREWRITE_INTERVAL;
+      endpoint.interval = value;
+    } else if (!config && !strcmp(name, "size") && (value == 8 || value == 16 || value == 32 || value == 64)
+        && value <= MAX_PAYLOAD_SIZE_EP) {
+      endpoint.set |= DESCREWRITE_SIZE;
+      endpoint.size = value;
+    } else if (config && !strcmp(name, "power") && value <= 500) {
+      set |= DESCREWRITE_POWER;
+      power = (value + 1) / 2;
+    } else if (config && !strcmp(name, "selfpowered") && value <= 1) {
+      set |= DESCREWRITE_SELF_POWERED;
+      selfPowered = value;
+    } else if (config && !strcmp(name, "wakeup") && value <= 1) {
+      set |= DESCREWRITE_REMOTE_WAKEUP;
+      remoteWakeup = value;
+    } else {
+      return -1;
+    }
+    spec += length;
+    if (*spec == ',') {
+      ++spec;
+    } else if (*spec) {
+      return -1;
+    }
+  }
+
+  if (config) {
+    rewrite->set = set;
+    rewrite->power = power;
+    rewrite->selfPowered = selfPowered;
+    rewrite->remoteWakeup = remoteWakeup;
+  } else {
+    rewrite->endpoints[!strcmp(target, "in")][number] = endpoint;
+  }
+
+  return 0;
+}
+
+int descrewrite_is_set(const s_descRewrite * rewrite) {
+
+  unsigned int dir, number;
+  for (dir = 0; dir < 2; ++dir) {
+    for (number = 0; number < 16; ++number) {
+      if (rewrite->endpoints[dir][number].set) {
+        return 1;
+      }
+    }
+  }
+  return rewrite->set != 0;
+}
+
+static void rewrite_configuration(const s_descRewrite * rewrite, uint8_t * config) {
+
+  if (rewrite->set & DESCREWRITE_POWER) {
+    printf("\n#i:rewrite: bMaxPower %u -> %u mA", config[8] * 2, rewrite->power * 2);
+    config[8] = rewrite->power;
+  }
+  if (rewrite->set & DESCREWRITE_SELF_POWERED) {
+    config[7] = (config[7] & ~CONFIG_ATT_SELF_POWERED) | (rewrite->selfPowered ? CONFIG_ATT_SELF_POWERED : 0);
+  }
+  if (rewrite->set & DESCREWRITE_REMOTE_WAKEUP) {
+    config[7] = (config[7] & ~CONFIG_ATT_REMOTE_WAKEUP) | (rewrite->remoteWakeup ? CONFIG_ATT_REMOTE_WAKEUP : 0);
+  }
+}
+
+/*
+ * \return 0 in case of success, -1 if the packet size can't hold the largest report of the direction
+ */
+static int rewrite_endpoint(const s_descRewrite * rewrite, uint8_t * endpoint,
+    s_endpointConfig * endpoints, unsigned int nbEndpoints, const unsigned int reportLengths[2]) {
+
+  if ((endpoint[3] & ENDPOINT_XFER_MASK) != ENDPOINT_XFER_INT) {
+    return 0;
+  }
+
+  uint8_t address = endpoint[2];
+  unsigned int dir = (address & ENDPOINT_DIR_IN) ? 1 : 0;
+  const s_descRewriteEndpoint * all = &rewrite->endpoints[dir][0];
+  const s_descRewriteEndpoint * one = all + (address & 0x0f);
+
+  unsigned int interval = endpoint[6];
+  unsigned int size = endpoint[4] | endpoint[5] << 8;
+  const s_descRewriteEndpoint * overrides[] = { all, one };
+  unsigned int i;
+  for (i = 0; i < sizeof(overrides) / sizeof(*overrides); ++i) {
+    if (overrides[i]->set & DESCREWRITE_INTERVAL) {
+      interval = overrides[i]->interval;
+    }
+    if (overrides[i]->set & DESCREWRITE_SIZE) {
+      size = overrides[i]->size;
+    }
+  }
+
+  if (size < reportLengths[dir]) {
+    fprintf(stderr, "endpoint 0x%02x: a wMaxPacketSize of %u can't hold the %u-byte %s reports\n",
+        address, size, reportLengths[dir], dir ? "IN" : "OUT");
+    return -1;
+  }
+
+  if (interval != endpoint[6] || size != (unsigned int)(endpoint[4] | endpoint[5] << 8)) {
+    printf("\n#i:rewrite: endpoint 0x%02x bInterval %u -> %u ms, wMaxPacketSize %u -> %u",
+        address, endpoint[6], interval, endpoint[4] | endpoint[5] << 8, size);
+  }
+  endpoint[4] = size;
+  endpoint[5] = size >> 8;
+  endpoint[6] = interval;
+
+  // the adapter sizes its endpoint banks from the endpoint table
+  for (i = 0; i < nbEndpoints && endpoints[i].number; ++i) {
+    if (endpoints[i].number == address) {
+      endpoints[i].size = size;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Walk the descriptors of a configuration and rewrite them.
+ *
+ * \return the length of the configuration, which stops at the first malformed descriptor,
+ * -1 in case of error
+ */
+static int rewrite_descriptors(const s_descRewrite * rewrite, uint8_t * config, unsigned int length,
+    s_endpointConfig * endpoints, unsigned int nbEndpoints, const unsigned int reportLengths[2]) {
+
+  unsigned int offset = 0;
+  while (offset + 2 <= length) {
+    uint8_t bLength = config[offset];
+    if (bLength < 2 || offset + bLength > length) {
+      break;
+    }
+    if (offset == 0 && config[1] == DT_CONFIG && bLength >= 9) {
+      rewrite_configuration(rewrite, config);
+    } else if (config[offset + 1] == DT_ENDPOINT && bLength >= 7
+        && rewrite_endpoint(rewrite, config + offset, endpoints, nbEndpoints, reportLengths) < 0) {
+      return -1;
+    }
+    offset += bLength;
+  }
+  return offset;
+}
+
+/*
+ * Rewrite the configuration descriptors in place, and rebuild the descriptors and their index:
+ * the wTotalLength fields and the index lengths follow the walked configurations,
+ * the offsets are packed in index order, entries sharing data keep sharing it.
+ * The endpoint table follows the packet sizes, which can't be smaller than the largest
+ * report of their direction in the report descriptors, or than the converted IN reports
+ * (inLength, 0 if the reports are not converted).
+ *
+ * \return 0 in case of success, -1 in case of error
+ */
+int descrewrite_apply(const s_descRewrite * rewrite, uint8_t * desc, unsigned int * descLength,
+    s_descriptorIndex * index, unsigned int nbIndex, s_endpointConfig * endpoints, unsigned int nbEndpoints,
+    unsigned int inLength) {
+
+  static uint8_t source[MAX_DESCRIPTORS_SIZE];
+  static s_descriptorIndex sourceIndex[MAX_DESCRIPTORS];
+
+  if (*descLength > sizeof(source) || nbIndex > sizeof(sourceIndex) / sizeof(*sourceIndex)) {
+    fprintf(stderr, "%s:%d %s: too many descriptors\n", __FILE__, __LINE__, __func__);
+    return -1;
+  }
+  memcpy(source, desc, *descLength);
+  memcpy(sourceIndex, index, nbIndex * sizeof(*index));
+
+  unsigned int i, j;
+  for (i = 0; i < nbIndex; ++i) {
+    const s_descriptorIndex * entry = sourceIndex + i;
+    if (entry->offset + entry->wLength > *descLength) {
+      fprintf(stderr, "%s:%d %s: descriptor wValue=0x%04x wIndex=0x%04x is out of the descriptors\n",
+          __FILE__, __LINE__, __func__, entry->wValue, entry->wIndex);
+      return -1;
+    }
+  }
+
+  unsigned int reportLengths[2] = { 0, inLength }; // [0] OUT, [1] IN
+  for (i = 0; i < nbIndex; ++i) {
+    const s_descriptorIndex * entry = sourceIndex + i;
+    unsigned int input, output;
+    if ((entry->wValue >> 8) != HID_DT_REPORT) {
+      continue;
+    }
+    if (hidplan_report_lengths(source + entry->offset, entry->wLength, &input, &output) < 0) {
+      return -1;
+    }
+    if (input > reportLengths[1]) {
+      reportLengths[1] = input;
+    }
+    if (output > reportLengths[0]) {
+      reportLengths[0] = output;
+    }
+  }
+
+  unsigned int length = 0;
+  for (i = 0; i < nbIndex; ++i) {
+    const s_descriptorIndex * entry = sourceIndex + i;
+    for (j = 0; j < i && (sourceIndex[j].offset != entry->offset || sourceIndex[j].wLength != entry->wLength); ++j) {}
+    if (j < i) {
+      index[i].offset = index[j].offset;
+      index[i].wLength = index[j].wLength;
+      continue;
+    }
+    uint8_t * data = desc + length;
+    memcpy(data, source + entry->offset, entry->wLength);
+    unsigned int wLength = entry->wLength;
+    if ((entry->wValue >> 8) == DT_CONFIG && wLength >= 9) {
+      int walked = rewrite_descriptors(rewrite, data, wLength, endpoints, nbEndpoints, reportLengths);
+      if (walked < 0) {
+        return -1;
+      }
+      wLength = walked;
+      data[2] = wLength;
+      data[3] = wLength >> 8;
+    }
+    index[i].offset = length;
+    index[i].wLength = wLength;
+    length += wLength;
+  }
+
+  *descLength = length;
+
+  return 0;
+}
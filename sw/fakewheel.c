@@ -0,0 +1,230 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#include <fakewheel.h>
+#include <gtimer.h>
+#include <hidplan.h>
+#include <string.h>
+
+#define FAKEWHEEL_IN_ENDPOINT  (USB_DIR_IN | 1)
+#define FAKEWHEEL_OUT_ENDPOINT (USB_DIR_OUT | 1)
+#define FAKEWHEEL_PACKET_SIZE  64
+#define FAKEWHEEL_PERIOD       1000 // us
+
+// where the G29 reports hold the inputs (the report id is at offset 0)
+#define FAKEWHEEL_BUTTONS_IDX 5
+#define FAKEWHEEL_WHEEL_IDX   43
+#define FAKEWHEEL_GAS_IDX     45
+#define FAKEWHEEL_BRAKE_IDX   47
+#define FAKEWHEEL_CLUTCH_IDX  49
+
+static unsigned char reportDescriptor[] =
+{
+  0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0x85, 0x01, // joystick, report 1
+  0x06, 0x00, 0xff, 0x09, 0x20, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02, // sticks
+  0x05, 0x01, 0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, // hat
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0e, 0x81, 0x02, // buttons
+  0x75, 0x06, 0x95, 0x01, 0x81, 0x03, 0x75, 0x08, 0x95, 0x23, 0x81, 0x03, // padding
+  0x05, 0x01, 0x09, 0x30, 0x09, 0x32, 0x09, 0x35, 0x09, 0x31, 0x15, 0x00, 0x27, 0xff, 0xff, 0x00, 0x00,
+  0x75, 0x10, 0x95, 0x04, 0x81, 0x02, // wheel, gas, brake, clutch
+  0x75, 0x08, 0x95, 0x0d, 0x81, 0x03, // padding
+  0x06, 0x00, 0xff, 0x09, 0x21, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x3f, 0x91, 0x02, // force feedback
+  0xc0,
+};
+
+static unsigned char rawConfiguration[] =
+{
+  0x09, USB_DT_CONFIG, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0xfa,
+  0x09, USB_DT_INTERFACE, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00,
+  0x09, 0x21, 0x11, 0x01, 0x21, 0x01, 0x22, sizeof(reportDescriptor) & 0xff, sizeof(reportDescriptor) >> 8,
+  0x07, USB_DT_ENDPOINT, FAKEWHEEL_IN_ENDPOINT, 0x03, FAKEWHEEL_PACKET_SIZE, 0x00, 0x01,
+  0x07, USB_DT_ENDPOINT, FAKEWHEEL_OUT_ENDPOINT, 0x03, FAKEWHEEL_PACKET_SIZE, 0x00, 0x01,
+};
+
+static struct usb_endpoint_descriptor * endpoints[2];
+static struct p_altInterface altInterface;
+static struct p_interface interface;
+static struct p_configuration configuration;
+static struct p_other other;
+static s_usb_descriptors descriptors;
+
+static struct
+{
+  int user;
+  USBASYNC_READ_CALLBACK fp_read;
+  USBASYNC_WRITE_CALLBACK fp_write;
+  USBASYNC_CLOSE_CALLBACK fp_close;
+  int timer;
+  unsigned int ticks;
+  int polled; // an IN transfer is pending
+  unsigned int outWrites; // pending OUT transfers
+  int control; // a control transfer is pending
+  struct usb_ctrlrequest setup;
+  unsigned char report[FAKEWHEEL_PACKET_SIZE];
+} wheel = { .timer = -1 };
+
+s_usb_descriptors * fakewheel_get_usb_descriptors(void) {
+
+  descriptors.device = (struct usb_device_descriptor) {
+    .bLength = sizeof(struct usb_device_descriptor),
+    .bDescriptorType = USB_DT_DEVICE,
+    .bcdUSB = 0x0200,
+    .bMaxPacketSize0 = 64,
+    .idVendor = FAKEWHEEL_VENDOR,
+    .idProduct = FAKEWHEEL_PRODUCT,
+    .bcdDevice = 0x8900,
+    .bNumConfigurations = 1,
+  };
+  descriptors.langId0 = (struct usb_string_descriptor) { .bLength = 4, .bDescriptorType = USB_DT_STRING, .wData = { 0x0409 } };
+
+  configuration.raw = rawConfiguration;
+  configuration.descriptor = (struct usb_config_descriptor *) rawConfiguration;
+  configuration.interfaces = &interface;
+  interface.bNumAltInterfaces = 1;
+  interface.altInterfaces = &altInterface;
+  altInterface.descriptor = (struct usb_interface_descriptor *) (rawConfiguration + 9);
+  altInterface.hidDescriptor = (struct usb_hid_descriptor *) (rawConfiguration + 18);
+  altInterface.bNumEndpoints = 2;
+  altInterface.endpoints = endpoints;
+  endpoints[0] = (struct usb_endpoint_descriptor *) (rawConfiguration + 27);
+  endpoints[1] = (struct usb_endpoint_descriptor *) (rawConfiguration + 34);
+  descriptors.configurations = &configuration;
+
+  other.wValue = HID_DT_REPORT << 8;
+  other.wIndex = 0;
+  other.wLength = sizeof(reportDescriptor);
+  other.data = reportDescriptor;
+  descriptors.nbOthers = 1;
+  descriptors.others = &other;
+
+  return &descriptors;
+}
+
+/*
+ * Fill the report with the inputs of this tick: the wheel sweeps from side to side
+ * every 2s, the pedals are pressed in turn, and the face buttons rotate.
+ */
+static void make_report(unsigned int ticks) {
+
+  unsigned char * report = wheel.report;
+  memset(report, 0x00, sizeof(wheel.report));
+  report[0] = 0x01;
+  memset(report + 1, 0x80, 4); // sticks
+
+  unsigned int phase = ticks % 2000;
+  unsigned short steering = 0x2000 + (phase < 1000 ? phase : 2000 - phase) * 0xc000 / 1000;
+  unsigned short gas = 0xffff, brake = 0xffff;
+  if (phase < 1000) {
+    gas -= phase * 0xffff / 1000;
+  } else {
+    brake -= (phase - 1000) * 0xffff / 1000;
+  }
+
+  unsigned int button = (ticks / 250) % 5;
+  report[FAKEWHEEL_BUTTONS_IDX] = 0x08 | (button < 4 ? 0x10 << button : 0x00);
+
+  report[FAKEWHEEL_WHEEL_IDX] = steering & 0xff;
+  report[FAKEWHEEL_WHEEL_IDX + 1] = steering >> 8;
+  report[FAKEWHEEL_GAS_IDX] = gas & 0xff;
+  report[FAKEWHEEL_GAS_IDX + 1] = gas >> 8;
+  report[FAKEWHEEL_BRAKE_IDX] = brake & 0xff;
+  report[FAKEWHEEL_BRAKE_IDX + 1] = brake >> 8;
+  report[FAKEWHEEL_CLUTCH_IDX] = 0xff;
+  report[FAKEWHEEL_CLUTCH_IDX + 1] = 0xff;
+}
+
+/*
+ * Complete the pending transfers, as the device would within a frame.
+ * The control requests get no data: the IN ones are stalled, the OUT ones acked.
+ */
+static int tick(int user) {
+
+  ++wheel.ticks;
+
+  if (wheel.control) {
+    wheel.control = 0;
+    int ret;
+    if (wheel.setup.bRequestType & USB_DIR_IN) {
+      ret = wheel.fp_read(wheel.user, 0, NULL, E_TRANSFER_STALL);
+    } else {
+      ret = wheel.fp_write(wheel.user, 0, wheel.setup.wLength);
+    }
+    if (ret < 0) {
+      return 1;
+    }
+  }
+
+  while (wheel.outWrites) {
+    --wheel.outWrites;
+    if (wheel.fp_write(wheel.user, FAKEWHEEL_OUT_ENDPOINT, FAKEWHEEL_PACKET_SIZE) < 0) {
+      return 1;
+    }
+  }
+
+  if (wheel.polled) {
+    wheel.polled = 0;
+    make_report(wheel.ticks);
+    if (wheel.fp_read(wheel.user, FAKEWHEEL_IN_ENDPOINT, wheel.report, sizeof(wheel.report)) < 0) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int tick_close(int user) {
+
+  wheel.timer = -1;
+  return wheel.fp_close(wheel.user);
+}
+
+int fakewheel_register(int user, USBASYNC_READ_CALLBACK fp_read, USBASYNC_WRITE_CALLBACK fp_write,
+    USBASYNC_CLOSE_CALLBACK fp_close, GPOLL_REGISTER_FD fp_register) {
+
+  wheel.user = user;
+  wheel.fp_read = fp_read;
+  wheel.fp_write = fp_write;
+  wheel.fp_close = fp_close;
+  wheel.timer = gtimer_start(user, FAKEWHEEL_PERIOD, tick, tick_close, fp_register);
+  return wheel.timer < 0 ? -1 : 0;
+}
+
+int fakewheel_poll(unsigned char endpoint) {
+
+  if (endpoint != FAKEWHEEL_IN_ENDPOINT) {
+    return -1;
+  }
+  wheel.polled = 1;
+  return 0;
+}
+
+int fakewheel_write(unsigned char endpoint, const void * buf, unsigned int count) {
+
+  if (endpoint == 0) {
+    if (wheel.control || count < sizeof(wheel.setup)) {
+      return -1;
+    }
+    memcpy(&wheel.setup, buf, sizeof(wheel.setup));
+    wheel.control = 1;
+    return 0;
+  }
+  if (endpoint != FAKEWHEEL_OUT_ENDPOINT || count > FAKEWHEEL_PACKET_SIZE) {
+    return -1;
+  }
+  ++wheel.outWrites;
+  return 0;
+}
+
+int fakewheel_close(void) {
+
+  if (wheel.timer >= 0) {
+    gtimer_close(wheel.timer);
+    wheel.timer = -1;
+  }
+  wheel.polled = 0;
+  wheel.outWrites = 0;
+  wheel.control = 0;
+  return 0;
+}
@@ -0,0 +1,423 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#include <hidplan.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_FIELDS 256
+#define MAX_USAGES 64
+#define MAX_FIELD_BITS 16
+
+#define ITEM_TYPE_MAIN   0
+#define ITEM_TYPE_GLOBAL 1
+#define ITEM_TYPE_LOCAL  2
+
+#define ITEM_TAG_INPUT            0x8
+#define ITEM_TAG_OUTPUT           0x9
+#define ITEM_TAG_USAGE_PAGE       0x0
+#define ITEM_TAG_LOGICAL_MIN      0x1
+#define ITEM_TAG_LOGICAL_MAX      0x2
+#define ITEM_TAG_REPORT_SIZE      0x7
+#define ITEM_TAG_REPORT_ID        0x8
+#define ITEM_TAG_REPORT_COUNT     0x9
+#define ITEM_TAG_PUSH             0xa
+#define ITEM_TAG_POP              0xb
+#define ITEM_TAG_USAGE            0x0
+#define ITEM_TAG_USAGE_MIN        0x1
+#define ITEM_TAG_USAGE_MAX        0x2
+
+#define ITEM_LONG 0xfe
+
+#define INPUT_CONSTANT 0x01
+#define INPUT_VARIABLE 0x02
+
+#define MAX_PUSH 4
+
+/*
+ * An input field of the report descriptor.
+ */
+typedef struct {
+  uint8_t reportId;
+  unsigned int bitOffset; // from the start of the report, including the report id
+  unsigned int bitSize;
+  uint16_t usagePage;
+  uint16_t usage;
+  int32_t min;
+  int32_t max;
+} s_field;
+
+typedef struct {
+  uint16_t usagePage;
+  int32_t min;
+  int32_t max;
+  unsigned int size;
+  unsigned int count;
+  uint8_t reportId;
+} s_globals;
+
+static uint32_t item_unsigned(const uint8_t * data, unsigned int size) {
+
+  uint32_t value = 0;
+  unsigned int i;
+  for (i = 0; i < size; ++i) {
+    value |= data[i] << (8 * i);
+  }
+  return value;
+}
+
+static int32_t item_signed(const uint8_t * data, unsigned int size) {
+
+  uint32_t value = item_unsigned(data, size);
+  if (size > 0 && size < 4 && (value & (1u << (8 * size - 1)))) {
+    value |= ~0u << (8 * size);
+  }
+  return value;
+}
+
+/*
+ * List the variable input fields of a report descriptor.
+ *
+ * \return the number of fields, or -1 in case of error
+ */
+static int parse_fields(const uint8_t * descriptor, unsigned int length, s_field * fields, unsigned int max) {
+
+  s_globals globals = { 0 };
+  s_globals stack[MAX_PUSH];
+  unsigned int depth = 0;
+  uint32_t usages[MAX_USAGES];
+  unsigned int nbUsages = 0;
+  uint32_t usageMin = 0;
+  uint32_t usageMax = 0;
+  int hasRange = 0;
+  unsigned int bitOffsets[256] = { 0 };
+  int usesIds = 0;
+  unsigned int count = 0;
+
+  const uint8_t * ptr = descriptor;
+  while (ptr < descriptor + length) {
+
+    if (*ptr == ITEM_LONG) {
+      if (ptr + 1 >= descriptor + length) {
+        break;
+      }
+      ptr += 3 + ptr[1];
+      continue;
+    }
+
+    unsigned int size = *ptr & 0x03;
+    if (size == 3) {
+      size = 4;
+    }
+    unsigned int type = (*ptr >> 2) & 0x03;
+    unsigned int tag = *ptr >> 4;
+    const uint8_t * data = ptr + 1;
+    if (data + size > descriptor + length) {
+      fprintf(stderr, "truncated report descriptor item at offset %u\n", (unsigned int)(ptr - descriptor));
+      return -1;
+    }
+    ptr = data + size;
+
+    if (type == ITEM_TYPE_GLOBAL) {
+      switch (tag) {
+      case ITEM_TAG_USAGE_PAGE:
+        globals.usagePage = item_unsigned(data, size);
+        break;
+      case ITEM_TAG_LOGICAL_MIN:
+        globals.min = item_signed(data, size);
+        break;
+      case ITEM_TAG_LOGICAL_MAX:
+        // a positive max is often declared with the sign bit set
+        globals.max = globals.min < 0 ? item_signed(data, size) : (int32_t)item_unsigned(data, size);
+        break;
+      case ITEM_TAG_REPORT_SIZE:
+        globals.size = item_unsigned(data, size);
+        break;
+      case ITEM_TAG_REPORT_ID:
+        globals.reportId = item_unsigned(data, size);
+        if (!usesIds) {
+          usesIds = 1;
+          memset(bitOffsets, 0x00, sizeof(bitOffsets));
+        }
+        if (bitOffsets[globals.reportId] == 0) {
+          bitOffsets[globals.reportId] = 8;
+        }
+        break;
+      case ITEM_TAG_REPORT_COUNT:
+        globals.count = item_unsigned(data, size);
+        break;
+      case ITEM_TAG_PUSH:
+        if (depth == MAX_PUSH) {
+          fprintf(stderr, "too many pushes in the report descriptor\n");
+          return -1;
+        }
+        stack[depth++] = globals;
+        break;
+      case ITEM_TAG_POP:
+        if (depth == 0) {
+          fprintf(stderr, "pop without push in the report descriptor\n");
+          return -1;
+        }
+        globals = stack[--depth];
+        break;
+      }
+    } else if (type == ITEM_TYPE_LOCAL) {
+      uint32_t usage = item_unsigned(data, size);
+      if (size < 4) {
+        usage |= globals.usagePage << 16;
+      }
+      switch (tag) {
+      case ITEM_TAG_USAGE:
+        if (nbUsages < MAX_USAGES) {
+          usages[nbUsages++] = usage;
+        }
+        break;
+      case ITEM_TAG_USAGE_MIN:
+        usageMin = usage;
+        hasRange = 1;
+        break;
+      case ITEM_TAG_USAGE_MAX:
+        usageMax = usage;
+        hasRange = 1;
+        break;
+      }
+    } else if (type == ITEM_TYPE_MAIN) {
+      if (tag == ITEM_TAG_INPUT) {
+        uint32_t flags = item_unsigned(data, size);
+        unsigned int i;
+        for (i = 0; i < globals.count; ++i) {
+          uint32_t usage = 0;
+          if (hasRange) {
+            usage = usageMin + i;
+            if (usage > usageMax) {
+              usage = usageMax;
+            }
+          } else if (nbUsages > 0) {
+            usage = usages[i < nbUsages ? i : nbUsages - 1];
+          }
+          // constant fields are padding, array fields hold usage indexes and are not decoded
+          if (!(flags & INPUT_CONSTANT) && (flags & INPUT_VARIABLE) && usage != 0) {
+            if (count == max) {
+              fprintf(stderr, "too many fields in the report descriptor\n");
+              return -1;
+            }
+            fields[count].reportId = globals.reportId;
+            fields[count].bitOffset = bitOffsets[globals.reportId] + i * globals.size;
+            fields[count].bitSize = globals.size;
+            fields[count].usagePage = usage >> 16;
+            fields[count].usage = usage & 0xffff;
+            fields[count].min = globals.min;
+            fields[count].max = globals.max;
+            ++count;
+          }
+        }
+        bitOffsets[globals.reportId] += globals.count * globals.size;
+      }
+      nbUsages = 0;
+      hasRange = 0;
+    }
+  }
+
+  return count;
+}
+
+/*
+ * Compile the decode plan of the targets from a report descriptor.
+ * The fields of the targets have to be in the report of the first target found.
+ *
+ * \return 0 in case of success, -1 in case of error
+ */
+int hidplan_compile(s_hidplan * plan, const uint8_t * descriptor, unsigned int length, const s_hidplanTarget * targets) {
+
+  memset(plan, 0x00, sizeof(*plan));
+
+  s_field fields[MAX_FIELDS];
+  int nbFields = parse_fields(descriptor, length, fields, sizeof(fields) / sizeof(*fields));
+  if (nbFields < 0) {
+    return -1;
+  }
+
+  int reportIdSet = 0;
+  const s_hidplanTarget * target;
+  for (target = targets; target->kind != HIDPLAN_NONE; ++target) {
+
+    unsigned int i;
+    for (i = 0; i < plan->nbOps; ++i) {
+      if (plan->ops[i].dstByte == target->dstByte && plan->ops[i].dstMask == target->dstMask) {
+        break;
+      }
+    }
+    if (i < plan->nbOps) {
+      continue; // the destination is already fed by a preferred usage
+    }
+
+    const s_field * field = NULL;
+    int f;
+    for (f = 0; f < nbFields && field == NULL; ++f) {
+      if (fields[f].usagePage == target->usagePage && fields[f].usage == target->usage) {
+        field = fields + f;
+      }
+    }
+    if (field == NULL) {
+      continue;
+    }
+
+    if (reportIdSet && field->reportId != plan->reportId) {
+      fprintf(stderr, "usage 0x%02x:0x%02x is not in report %u\n", target->usagePage, target->usage, plan->reportId);
+      continue;
+    }
+    if (field->bitSize == 0 || field->bitSize > MAX_FIELD_BITS || field->max <= field->min) {
+      fprintf(stderr, "usage 0x%02x:0x%02x: unsupported field\n", target->usagePage, target->usage);
+      continue;
+    }
+    if (plan->nbOps == HIDPLAN_MAX_OPS) {
+      fprintf(stderr, "too many decode targets\n");
+      return -1;
+    }
+
+    plan->reportId = field->reportId;
+    reportIdSet = 1;
+
+    unsigned int byte = field->bitOffset / 8;
+    unsigned int shift = field->bitOffset % 8;
+    unsigned int nbBytes = (shift + field->bitSize + 7) / 8;
+    if (byte + nbBytes > 0xff) {
+      fprintf(stderr, "usage 0x%02x:0x%02x is out of the reports\n", target->usagePage, target->usage);
+      continue;
+    }
+
+    uint32_t range = field->max - field->min;
+
+    plan->ops[plan->nbOps].kind = target->kind;
+    plan->ops[plan->nbOps].byte = byte;
+    plan->ops[plan->nbOps].nbBytes = nbBytes;
+    plan->ops[plan->nbOps].shift = shift;
+    plan->ops[plan->nbOps].mask = (1u << field->bitSize) - 1;
+    plan->ops[plan->nbOps].sign = field->min < 0 ? 1u << (field->bitSize - 1) : 0;
+    plan->ops[plan->nbOps].min = field->min;
+    plan->ops[plan->nbOps].range = range;
+    plan->ops[plan->nbOps].scale = ((0xffffull << 32) + range - 1) / range;
+    plan->ops[plan->nbOps].dstByte = target->dstByte;
+    plan->ops[plan->nbOps].dstMask = target->dstMask;
+    ++plan->nbOps;
+
+    if (byte + nbBytes > plan->length) {
+      plan->length = byte + nbBytes;
+    }
+  }
+
+  if (plan->nbOps == 0) {
+    fprintf(stderr, "none of the decoded usages is in the report descriptor\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+void hidplan_print(const s_hidplan * plan) {
+
+  static const char * kinds[] = {
+    [HIDPLAN_AXIS] = "axis",
+    [HIDPLAN_INVERTED_AXIS] = "inverted axis",
+    [HIDPLAN_BUTTON] = "button",
+    [HIDPLAN_HAT] = "hat",
+    [HIDPLAN_MERGED_BUTTON] = "merged button",
+    [HIDPLAN_MERGED_HAT] = "merged hat",
+  };
+
+  printf("\n#i:decode plan for report %u (%u bytes):", plan->reportId, plan->length);
+  unsigned int i;
+  for (i = 0; i < plan->nbOps; ++i) {
+    printf("\n#i:  %s: bit %u, %u bits, logical %d..%d -> byte %u mask 0x%02x", kinds[plan->ops[i].kind],
+        plan->ops[i].byte * 8 + plan->ops[i].shift, __builtin_popcount(plan->ops[i].mask),
+        plan->ops[i].min, (int)(plan->ops[i].min + plan->ops[i].range), plan->ops[i].dstByte, plan->ops[i].dstMask);
+  }
+}
+
+/*
+ * Get the length of the largest input and output reports of a report descriptor,
+ * including the report id.
+ *
+ * \return 0 in case of success, -1 in case of error
+ */
+int hidplan_report_lengths(const uint8_t * descriptor, unsigned int length, unsigned int * input, unsigned int * output) {
+
+  s_globals globals = { 0 };
+  s_globals stack[MAX_PUSH];
+  unsigned int depth = 0;
+  unsigned int bits[2][256] = { { 0 } }; // [0] input, [1] output, by report id
+
+  const uint8_t * ptr = descriptor;
+  while (ptr < descriptor + length) {
+
+    if (*ptr == ITEM_LONG) {
+      if (ptr + 1 >= descriptor + length) {
+        break;
+      }
+      ptr += 3 + ptr[1];
+      continue;
+    }
+
+    unsigned int size = *ptr & 0x03;
+    if (size == 3) {
+      size = 4;
+    }
+    unsigned int type = (*ptr >> 2) & 0x03;
+    unsigned int tag = *ptr >> 4;
+    const uint8_t * data = ptr + 1;
+    if (data + size > descriptor + length) {
+      fprintf(stderr, "truncated report descriptor item at offset %u\n", (unsigned int)(ptr - descriptor));
+      return -1;
+    }
+    ptr = data + size;
+
+    if (type == ITEM_TYPE_GLOBAL) {
+      switch (tag) {
+      case ITEM_TAG_REPORT_SIZE:
+        globals.size = item_unsigned(data, size);
+        break;
+      case ITEM_TAG_REPORT_ID:
+        globals.reportId = item_unsigned(data, size);
+        break;
+      case ITEM_TAG_REPORT_COUNT:
+        globals.count = item_unsigned(data, size);
+        break;
+      case ITEM_TAG_PUSH:
+        if (depth == MAX_PUSH) {
+          fprintf(stderr, "too many pushes in the report descriptor\n");
+          return -1;
+        }
+        stack[depth++] = globals;
+        break;
+      case ITEM_TAG_POP:
+        if (depth == 0) {
+          fprintf(stderr, "pop without push in the report descriptor\n");
+          return -1;
+        }
+        globals = stack[--depth];
+        break;
+      }
+    } else if (type == ITEM_TYPE_MAIN && (tag == ITEM_TAG_INPUT || tag == ITEM_TAG_OUTPUT)) {
+      bits[tag == ITEM_TAG_OUTPUT][globals.reportId] += globals.count * globals.size;
+    }
+  }
+
+  unsigned int * lengths[] = { input, output };
+  unsigned int dir, id;
+  for (dir = 0; dir < 2; ++dir) {
+    *lengths[dir] = 0;
+    for (id = 0; id < 256; ++id) {
+      if (bits[dir][id] == 0) {
+        continue;
+      }
+      unsigned int reportLength = (id ? 1 : 0) + (bits[dir][id] + 7) / 8;
+      if (reportLength > *lengths[dir]) {
+        *lengths[dir] = reportLength;
+      }
+    }
+  }
+
+  return 0;
+}
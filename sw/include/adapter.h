@@ -14,6 +14,7 @@ typedef int (* ADAPTER_CLOSE_CALLBACK)(int user);
 
 int adapter_open(const char * port, ADAPTER_READ_CALLBACK fp_read, ADAPTER_WRITE_CALLBACK fp_write, ADAPTER_CLOSE_CALLBACK fp_close);
 int adapter_send(int adapter, unsigned char type, const unsigned char * data, unsigned int count);
+int adapter_send_frame(int adapter, const s_packet * packet);
 int adapter_close ();
 char adapter_debug (char dbg);
 
@@ -0,0 +1,58 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef AXIS_H_
+#define AXIS_H_
+
+#include <stdint.h>
+
+/*
+ * Shaping of a 16-bit axis, in percents of the travel
+ * (of the half travel from the center for a centered axis).
+ */
+typedef struct {
+  unsigned int deadzone; // the output stays at rest below this
+  unsigned int saturation; // the output reaches its max at this
+  unsigned int curve; // share of the cubic response, 0 is linear
+  unsigned int range; // the part of the input travel that covers the full output travel
+} s_axisConfig;
+
+#define AXIS_CONFIG_LINEAR { .deadzone = 0, .saturation = 100, .curve = 0, .range = 100 }
+
+// the output maxima an axis keeps a table for, when several converters map it
+#define AXIS_MAX_TABLES 4
+
+/*
+ * The axis is mapped through a table built for the output max of the converter,
+ * so that a mapping is a single load. The tables are built before the reports
+ * are converted, a max with no table is mapped linearly.
+ * Without shaping the table holds the linear mapping of get_cmap().
+ */
+typedef struct {
+  s_axisConfig config;
+  int centered; // the rest position is the middle of the travel (a wheel), else an end (a pedal)
+  int inverted; // a pedal rests at the max of the travel, as the G29 ones do
+  unsigned int next; // the table replaced when all are built
+  struct {
+    long max; // the output max the table is built for, 0 if not built
+    uint16_t * lut; // 65536 entries, allocated on the first build
+  } tables[AXIS_MAX_TABLES];
+} s_axis;
+
+int axis_parse(s_axis * axis, const char * params);
+int axis_build(s_axis * axis, long max);
+long axis_linear(long x, long max);
+
+static inline long axis_map(s_axis * axis, uint16_t value, long max) {
+
+  int i;
+  for (i = 0; i < AXIS_MAX_TABLES && axis->tables[i].max != max; ++i) {}
+  if (i == AXIS_MAX_TABLES) {
+    return axis_linear(value, max);
+  }
+  return axis->tables[i].lut[value];
+}
+
+#endif /* AXIS_H_ */
@@ -0,0 +1,37 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef CONVERTERS_H_
+#define CONVERTERS_H_
+
+#include <axis.h>
+
+/*
+ * The axes of the wheel reports the converters map, shaped with --axis.
+ */
+enum {
+  AXIS_WHEEL,
+  AXIS_GAS,
+  AXIS_BRAKE,
+  AXIS_NB,
+};
+
+extern s_axis whlAxes[AXIS_NB];
+
+/*
+ * A converter generated by tools/profilec from a profile of the profiles directory.
+ */
+typedef struct {
+  int vid;
+  int pid;
+  int (*whl)(char *rep, int rl, char *out);
+  long max[AXIS_NB]; // the output maxima of the axes, 0 for an axis not mapped
+  const char * profile;
+} s_generatedConverter;
+
+// terminated by an entry with no converter
+extern const s_generatedConverter generatedConverters[];
+
+#endif /* CONVERTERS_H_ */
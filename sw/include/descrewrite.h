@@ -0,0 +1,44 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef DESCREWRITE_H_
+#define DESCREWRITE_H_
+
+#include <protocol.h>
+
+// the fields a rewrite overrides
+#define DESCREWRITE_INTERVAL      (1 << 0)
+#define DESCREWRITE_SIZE          (1 << 1)
+#define DESCREWRITE_POWER         (1 << 2)
+#define DESCREWRITE_SELF_POWERED  (1 << 3)
+#define DESCREWRITE_REMOTE_WAKEUP (1 << 4)
+
+/*
+ * The overrides of an interrupt endpoint, number 0 stands for all the endpoints of a direction.
+ */
+typedef struct {
+  uint8_t set;
+  uint8_t interval; // bInterval, in ms
+  uint8_t size; // wMaxPacketSize
+} s_descRewriteEndpoint;
+
+/*
+ * The overrides applied to the configuration descriptors before they are sent to the adapter.
+ */
+typedef struct {
+  s_descRewriteEndpoint endpoints[2][16]; // [0] OUT, [1] IN, by endpoint number
+  uint8_t set;
+  uint8_t power; // bMaxPower, in 2 mA units
+  uint8_t selfPowered;
+  uint8_t remoteWakeup;
+} s_descRewrite;
+
+int descrewrite_parse(s_descRewrite * rewrite, const char * spec);
+int descrewrite_is_set(const s_descRewrite * rewrite);
+int descrewrite_apply(const s_descRewrite * rewrite, uint8_t * desc, unsigned int * descLength,
+    s_descriptorIndex * index, unsigned int nbIndex, s_endpointConfig * endpoints, unsigned int nbEndpoints,
+    unsigned int inLength);
+
+#endif /* DESCREWRITE_H_ */
@@ -0,0 +1,28 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef FAKEWHEEL_H_
+#define FAKEWHEEL_H_
+
+#include <gusb.h>
+#include <gpoll.h>
+
+/*
+ * A G29 (PS4 mode) that exists only in the process, for running the proxy
+ * against the simulated adapter (fw/sim) without any hardware.
+ * The calls mirror the gusb ones, the transfers complete at the next 1ms tick.
+ */
+
+#define FAKEWHEEL_VENDOR  0x046d
+#define FAKEWHEEL_PRODUCT 0xc260
+
+s_usb_descriptors * fakewheel_get_usb_descriptors(void);
+int fakewheel_register(int user, USBASYNC_READ_CALLBACK fp_read, USBASYNC_WRITE_CALLBACK fp_write,
+    USBASYNC_CLOSE_CALLBACK fp_close, GPOLL_REGISTER_FD fp_register);
+int fakewheel_poll(unsigned char endpoint);
+int fakewheel_write(unsigned char endpoint, const void * buf, unsigned int count);
+int fakewheel_close(void);
+
+#endif /* FAKEWHEEL_H_ */
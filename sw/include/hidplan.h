@@ -0,0 +1,144 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef HIDPLAN_H_
+#define HIDPLAN_H_
+
+#include <stdint.h>
+
+#ifndef HID_DT_REPORT
+#define HID_DT_REPORT 0x22
+#endif
+
+#define HID_PAGE_DESKTOP    0x01
+#define HID_PAGE_SIMULATION 0x02
+#define HID_PAGE_BUTTON     0x09
+
+#define HID_USAGE_X           0x30
+#define HID_USAGE_Y           0x31
+#define HID_USAGE_Z           0x32
+#define HID_USAGE_RZ          0x35
+#define HID_USAGE_HAT         0x39
+#define HID_USAGE_ACCELERATOR 0xc4
+#define HID_USAGE_BRAKE       0xc5
+#define HID_USAGE_STEERING    0xc8
+
+typedef enum {
+  HIDPLAN_NONE,
+  HIDPLAN_AXIS, // scaled to a 16-bit little-endian value, logical min to 0
+  HIDPLAN_INVERTED_AXIS, // scaled to a 16-bit little-endian value, logical min to 0xffff
+  HIDPLAN_BUTTON, // the destination bits are all set if the source is not 0
+  HIDPLAN_HAT, // the direction from the logical min, 8 in the null state, the destination mask starts at bit 0
+  HIDPLAN_MERGED_BUTTON, // as a button, but the destination bits are only set, never cleared
+  HIDPLAN_MERGED_HAT, // as a hat, but the destination is left as is in the null state
+} e_hidplanKind;
+
+/*
+ * A destination of the decoded reports, and the usage that feeds it.
+ * The first target of a destination whose usage is in the report descriptor is used.
+ * The destination bytes are offsets in the decoded reports, the mask is ignored for the axes.
+ */
+typedef struct {
+  e_hidplanKind kind;
+  uint16_t usagePage;
+  uint16_t usage;
+  uint8_t dstByte;
+  uint8_t dstMask;
+} s_hidplanTarget;
+
+#define HIDPLAN_MAX_OPS 32
+
+/*
+ * The decode plan compiled from the report descriptor: one flat operation per target,
+ * so that decoding a report does not look at the descriptor again.
+ */
+typedef struct {
+  uint8_t reportId; // 0 if the device does not use report ids
+  unsigned int length; // the source bytes the operations read
+  unsigned int nbOps;
+  struct {
+    uint8_t kind;
+    uint8_t byte; // the first source byte of the field
+    uint8_t nbBytes; // 1 to 3
+    uint8_t shift;
+    uint16_t mask; // after the shift
+    uint16_t sign; // the sign bit after the shift, 0 if the field is unsigned
+    int32_t min;
+    uint32_t range; // logical max - logical min
+    uint64_t scale; // 0xffff / range, in 32.32 fixed point
+    uint8_t dstByte;
+    uint8_t dstMask;
+  } ops[HIDPLAN_MAX_OPS];
+} s_hidplan;
+
+int hidplan_compile(s_hidplan * plan, const uint8_t * descriptor, unsigned int length, const s_hidplanTarget * targets);
+void hidplan_print(const s_hidplan * plan);
+int hidplan_report_lengths(const uint8_t * descriptor, unsigned int length, unsigned int * input, unsigned int * output);
+
+/*
+ * Decode a report into the destination, only the bits of the targets are written.
+ *
+ * \return 0 in case of success, -1 if the report does not hold the fields of the plan
+ */
+static inline int hidplan_apply(const s_hidplan * plan, const uint8_t * src, unsigned int length, uint8_t * dst) {
+
+  if (length < plan->length || (plan->reportId && src[0] != plan->reportId)) {
+    return -1;
+  }
+
+  unsigned int i;
+  for (i = 0; i < plan->nbOps; ++i) {
+    uint32_t raw = src[plan->ops[i].byte];
+    if (plan->ops[i].nbBytes > 1) {
+      raw |= src[plan->ops[i].byte + 1] << 8;
+    }
+    if (plan->ops[i].nbBytes > 2) {
+      raw |= src[plan->ops[i].byte + 2] << 16;
+    }
+    int32_t value = (raw >> plan->ops[i].shift) & plan->ops[i].mask;
+    if (value & plan->ops[i].sign) {
+      value -= plan->ops[i].mask + 1;
+    }
+    value -= plan->ops[i].min;
+    uint8_t dstMask = plan->ops[i].dstMask;
+    switch (plan->ops[i].kind) {
+    case HIDPLAN_AXIS:
+    case HIDPLAN_INVERTED_AXIS:
+    {
+      uint32_t scaled = 0;
+      if (value > 0) {
+        scaled = (value >= (int32_t) plan->ops[i].range) ? 0xffff : (value * plan->ops[i].scale) >> 32;
+      }
+      if (plan->ops[i].kind == HIDPLAN_INVERTED_AXIS) {
+        scaled = 0xffff - scaled;
+      }
+      dst[plan->ops[i].dstByte] = scaled;
+      dst[plan->ops[i].dstByte + 1] = scaled >> 8;
+    }
+      break;
+    case HIDPLAN_BUTTON:
+      dst[plan->ops[i].dstByte] = (dst[plan->ops[i].dstByte] & ~dstMask) | (-(value != 0) & dstMask);
+      break;
+    case HIDPLAN_MERGED_BUTTON:
+      dst[plan->ops[i].dstByte] |= -(value != 0) & dstMask;
+      break;
+    case HIDPLAN_HAT:
+      if (value < 0 || (uint32_t) value > plan->ops[i].range) {
+        value = 8;
+      }
+      dst[plan->ops[i].dstByte] = (dst[plan->ops[i].dstByte] & ~dstMask) | (value & dstMask);
+      break;
+    case HIDPLAN_MERGED_HAT:
+      if (value >= 0 && (uint32_t) value <= plan->ops[i].range) {
+        dst[plan->ops[i].dstByte] = (dst[plan->ops[i].dstByte] & ~dstMask) | (value & dstMask);
+      }
+      break;
+    }
+  }
+
+  return 0;
+}
+
+#endif /* HIDPLAN_H_ */
@@ -9,5 +9,25 @@
 int proxy_init(int vid, int pid);
 int proxy_start(char * port);
 void proxy_stop();
+void proxy_set_cached_in(int enable);
+void proxy_set_stats(int enable);
+void proxy_set_histograms(const char * file);
+void proxy_set_jit(int enable);
+void proxy_set_single_bank(int enable);
+void proxy_set_local_hid(int enable);
+void proxy_add_static_feature(unsigned char reportId);
+void proxy_set_ctl_ttl(unsigned int ms);
+void proxy_add_cached_report(unsigned char reportId);
+int proxy_set_latch_mask(const char * hex);
+int proxy_set_remap(const char * file);
+int proxy_set_axis(const char * spec);
+void proxy_set_decode(int enable);
+void proxy_set_fake_wheel(int enable);
+void proxy_set_generated(int enable);
+void proxy_set_profile_dir(const char * dir);
+void proxy_set_save_profile_dir(const char * dir);
+int proxy_set_rewrite(const char * spec);
+int proxy_add_input(const char * spec);
+int proxy_add_mirror(const char * spec);
 
 #endif /* PROXY_H_ */
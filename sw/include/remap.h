@@ -0,0 +1,67 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef REMAP_H_
+#define REMAP_H_
+
+#include <stdint.h>
+
+/*
+ * A remap entry copies bits of a source report byte into a destination report byte.
+ * By default the destination bits are all set if any of the source bits is set (a button).
+ * With field set, the source bits are copied as a value into the destination bits,
+ * both aligned on the lowest bit of their mask (a hat), the extra destination bits are cleared.
+ * The destination bits of all the entries are cleared before the remap.
+ */
+typedef struct {
+  uint8_t srcByte;
+  uint8_t srcMask;
+  uint8_t dstByte;
+  uint8_t dstMask;
+  uint8_t field;
+} s_remapEntry;
+
+// an entry for a 16-bit little-endian destination mask
+#define REMAP_ENTRY16(SRC_BYTE, SRC_MASK, DST_OFFSET, DST_MASK16) \
+  { SRC_BYTE, SRC_MASK, (DST_OFFSET) + ((DST_MASK16) > 0xff), (DST_MASK16) > 0xff ? (DST_MASK16) >> 8 : (DST_MASK16), 0 }
+
+#define REMAP_MAX_ENTRIES 64
+#define REMAP_MAX_LUTS 16
+
+/*
+ * The entries compiled into one 256-entry table per (source byte, destination byte) pair,
+ * so that a remap is a few loads and ORs, without branches.
+ */
+typedef struct {
+  unsigned int nbLuts;
+  struct {
+    uint8_t src;
+    uint8_t dst;
+    uint8_t lut[256];
+  } luts[REMAP_MAX_LUTS];
+  unsigned int nbClears;
+  struct {
+    uint8_t dst;
+    uint8_t keep; // the bits not written by the entries
+  } clears[REMAP_MAX_LUTS];
+} s_remap;
+
+int remap_compile(s_remap * remap, const s_remapEntry * entries, unsigned int count,
+    unsigned int srcLength, unsigned int dstLength);
+void remap_apply_entries(const s_remapEntry * entries, unsigned int count, const uint8_t * src, uint8_t * dst);
+int remap_load(const char * file, s_remapEntry * entries, unsigned int max);
+
+static inline void remap_apply(const s_remap * remap, const uint8_t * src, uint8_t * dst) {
+
+  unsigned int i;
+  for (i = 0; i < remap->nbClears; ++i) {
+    dst[remap->clears[i].dst] &= remap->clears[i].keep;
+  }
+  for (i = 0; i < remap->nbLuts; ++i) {
+    dst[remap->luts[i].dst] |= remap->luts[i].lut[src[remap->luts[i].src]];
+  }
+}
+
+#endif /* REMAP_H_ */
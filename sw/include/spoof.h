@@ -0,0 +1,63 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef SPOOF_H_
+#define SPOOF_H_
+
+#include <protocol.h>
+#include <stddef.h>
+
+/*
+ * A configuration frame of a spoofed device, the frames of a device end with an E_TYPE_RESET one.
+ */
+typedef struct spoof_pkt {
+  unsigned char type;
+  unsigned int  len;
+  unsigned char * pkt;
+} SPOOF_PKT;
+
+#define SPOOF_PROFILE_MAGIC 0x46505355 // "USPF"
+#define SPOOF_PROFILE_VERSION 1
+
+/*
+ * A spoof profile file is named <vid>_<pid>.spoof (lowercase hex) after the spoofed device,
+ * and holds this header followed by the records: the descriptors, index and endpoints frames.
+ * All the values are little-endian.
+ */
+typedef struct PACKED {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t vid;
+  uint16_t pid;
+  uint16_t handlerVid; // the converters to use, 0 if none
+  uint16_t handlerPid;
+  uint16_t nbRecords;
+  uint32_t length; // of the records
+  uint32_t checksum; // config_hash() of the records
+} s_spoofProfileHeader;
+
+typedef struct PACKED {
+  uint8_t type;
+  uint16_t length;
+} s_spoofRecordHeader;
+
+/*
+ * A spoof profile mapped from its file, the frames point into the mapping.
+ */
+typedef struct {
+  uint16_t vid;
+  uint16_t pid;
+  uint16_t handlerVid;
+  uint16_t handlerPid;
+  void * map;
+  size_t size;
+  SPOOF_PKT * frames;
+} s_spoofProfile;
+
+int spoof_profile_load(const char * dir, int vid, int pid, s_spoofProfile * profile);
+void spoof_profile_unload(s_spoofProfile * profile);
+int spoof_profile_save(const char * dir, int vid, int pid, int handlerVid, int handlerPid, const SPOOF_PKT * frames);
+
+#endif /* SPOOF_H_ */
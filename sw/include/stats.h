@@ -0,0 +1,55 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdio.h>
+
+#define STATS_BINS 64
+
+typedef struct {
+  const char * name;
+  unsigned int binUs; // width of a bin
+  unsigned int bins[STATS_BINS];
+  unsigned int overflow; // values beyond the last bin
+  unsigned int count;
+  double sum;
+  double min;
+  double max;
+} s_histogram;
+
+void stats_hist_init(s_histogram * hist, const char * name, unsigned int binUs);
+void stats_hist_add(s_histogram * hist, double us);
+void stats_hist_print(FILE * file, const s_histogram * hist);
+void stats_hist_export(FILE * file, const s_histogram * hist);
+
+#define STATS_CLOCK_SAMPLES 64
+
+/*
+ * Maps the adapter clock to the host clock, from ping exchanges.
+ * All the times are in microseconds.
+ */
+typedef struct {
+  struct {
+    double host; // middle of the exchange
+    double adapter;
+    double rtt;
+  } samples[STATS_CLOCK_SAMPLES];
+  unsigned int nbSamples;
+  unsigned int next;
+  double offset; // host = offset + adapter * (1 + drift)
+  double drift;
+  double minRtt;
+  double avgRtt; // moving average
+  int valid;
+} s_clockSync;
+
+void stats_clock_init(s_clockSync * sync);
+void stats_clock_add(s_clockSync * sync, double sent, double received, double adapter);
+double stats_clock_to_host(const s_clockSync * sync, double adapter);
+double stats_clock_to_adapter(const s_clockSync * sync, double host);
+
+#endif /* STATS_H_ */
@@ -7,6 +7,7 @@
 #define GTIMER_H_
 
 #include "gpoll.h"
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,6 +21,9 @@ int gtimer_start(int user, int usec, GPOLL_READ_CALLBACK fp_read, GPOLL_CLOSE_CA
     GPOLL_REGISTER_HANDLE fp_register);
 #endif
 int gtimer_close(int timer);
+#ifndef WIN32
+int gtimer_set_deadline(int timer, const struct timespec * deadline);
+#endif
 
 #ifdef __cplusplus
 }
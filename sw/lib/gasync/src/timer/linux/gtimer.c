@@ -114,6 +114,24 @@ int gtimer_start(int user, int usec, GPOLL_READ_CALLBACK fp_read, GPOLL_CLOSE_CA
   return slot;
 }
 
+/*
+ * Fire the timer once at the given CLOCK_MONOTONIC time.
+ * A timer started with a 0 period only fires this way.
+ */
+int gtimer_set_deadline(int timer, const struct timespec * deadline) {
+
+  CHECK_TIMER(timer, -1)
+
+  struct itimerspec new_value = { .it_value = *deadline };
+
+  if (timerfd_settime(timers[timer].fd, TFD_TIMER_ABSTIME, &new_value, NULL)) {
+    PRINT_ERROR_ERRNO("timerfd_settime")
+    return -1;
+  }
+
+  return 0;
+}
+
 int gtimer_close(int timer) {
 
   CHECK_TIMER(timer, -1)
@@ -0,0 +1,30 @@
+# PS2:Logitech Driving Force Pro
+# compiled into a converter by tools/profilec at build time, see the README
+#
+# handler <vid> <pid>: the spoofed device
+# length <bytes>: the length of the converted reports
+# axis <wheel|gas|brake> <source byte> <byte> <bytes> <max> [shift]: the 16-bit little-endian
+#   axis of the source reports (the G29 ones) mapped to [0, max], shifted left and written
+#   little-endian into the bytes of the converted reports
+# remap <source byte> <source mask> <destination byte> <destination mask> [field]:
+#   a button or hat entry, as in the --remap files
+#
+name whl_ps2_dfp
+handler 0x046d 0xc298
+length 9
+axis wheel 44 1 2 16383
+axis gas 46 6 1 255
+axis brake 48 7 1 255
+remap 6 0x10 2 0x80 # square
+remap 6 0x20 2 0x40 # cross
+remap 6 0x0f 4 0xf0 1 # hat
+remap 7 0x01 3 0x08 # L1
+remap 7 0x02 3 0x04 # R1
+remap 6 0x40 3 0x01 # circle
+remap 6 0x80 3 0x02 # triangle
+remap 7 0x04 3 0x20 # L2
+remap 7 0x08 3 0x10 # R2
+remap 7 0x40 4 0x02 # L3
+remap 7 0x80 4 0x01 # R3
+remap 7 0x10 3 0x40 # share -> select
+remap 7 0x20 3 0x80 # options -> start
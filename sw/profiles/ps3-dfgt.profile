@@ -0,0 +1,31 @@
+# PS3:Logitech Driving Force GT
+# compiled into a converter by tools/profilec at build time, see the README
+#
+# handler <vid> <pid>: the spoofed device
+# length <bytes>: the length of the converted reports
+# axis <wheel|gas|brake> <source byte> <byte> <bytes> <max> [shift]: the 16-bit little-endian
+#   axis of the source reports (the G29 ones) mapped to [0, max], shifted left and written
+#   little-endian into the bytes of the converted reports
+# remap <source byte> <source mask> <destination byte> <destination mask> [field]:
+#   a button or hat entry, as in the --remap files
+#
+name whl_ps3_dfgt
+handler 0x046d 0xc29a
+length 9
+axis wheel 44 5 2 16383
+axis gas 46 7 1 255
+axis brake 48 8 1 255
+remap 6 0x0f 1 0x0f 1 # hat
+remap 6 0x10 1 0x20 # square
+remap 6 0x20 1 0x10 # cross
+remap 6 0x40 1 0x40 # circle
+remap 6 0x80 1 0x80 # triangle
+remap 7 0x01 2 0x02 # L1
+remap 7 0x02 2 0x01 # R1
+remap 7 0x04 2 0x08 # L2
+remap 7 0x08 2 0x04 # R2
+remap 7 0x40 2 0x80 # L3
+remap 7 0x80 2 0x40 # R3
+remap 7 0x10 2 0x10 # share -> select
+remap 7 0x20 2 0x20 # options -> start
+remap 8 0x01 4 0x01 # PS
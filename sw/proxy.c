@@ -13,10 +13,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <ctype.h>
 #include <gpoll.h>
 #include <gtimer.h>
 #include <names.h>
 #include <prio.h>
+#include <stats.h>
+#include <remap.h>
+#include <converters.h>
+#include <hidplan.h>
+#include <spoof.h>
+#include <descrewrite.h>
+#include <fakewheel.h>
 #include <sys/time.h>
 
 #include <ff_lg.h>
@@ -32,9 +41,13 @@
 #define PRINT_TRANSFER_READ_ERROR(ENDPOINT,MESSAGE) fprintf(stderr, "\n#e:%s:%d %s: read transfer failed on endpoint %hhu with error: %s", __FILE__, __LINE__, __func__, ENDPOINT & USB_ENDPOINT_NUMBER_MASK, MESSAGE);
 
 static int usb = -1;
+static int fakeWheel = 0; // the wheel is simulated in the process (--fake-wheel)
 static int adapter = -1;
 static int init_timer = -1;
 
+#define INIT_TIMEOUT 1000000 // us
+#define UPLOAD_TIMEOUT 5000000 // us, the EEPROM writes take up to 3.5 s
+
 static s_usb_descriptors * descriptors = NULL;
 static unsigned char desc[MAX_DESCRIPTORS_SIZE] = {};
 static unsigned char * pDesc = desc;
@@ -43,10 +56,155 @@ static s_descriptorIndex * pDescIndex = descIndex;
 static s_endpointConfig endpoints[MAX_ENDPOINTS] = {};
 static s_endpointConfig * pEndpoints = endpoints;
 
-static uint8_t descIndexSent = 0;
-static uint8_t endpointsSent = 0;
+/*
+ * Checksum of the configuration streamed to the adapter,
+ * the adapter returns its own in the endpoints ack.
+ */
+static uint16_t configChecksum = 0;
+
+static struct timespec startTime; // CLOCK_MONOTONIC, as the timers
+
+/*
+ * Number of IN packets that can be sent to the adapter without waiting.
+ * The adapter advertises its slots in the endpoints ack,
+ * and returns them by batches in the IN acks.
+ * The console reads the queued reports in order, so only MAX_IN_FLIGHT of the slots are used:
+ * the reports that can't be sent yet are merged in the mailbox, instead of aging in the queue.
+ * Two cover the round trip of the credits, one alone leaves polls unanswered with a slow serial link.
+ */
+static uint8_t inCredits = 0;
+
+#define MAX_IN_FLIGHT 2
+
+/*
+ * With cachedIn the adapter keeps the last IN report of each endpoint
+ * and answers the console polls from it, so only changed reports are sent.
+ */
+static uint8_t cachedIn = 0;
+
+/*
+ * The adapter uses two banks for the endpoints that fit into its DPRAM,
+ * unless singleBank is set.
+ */
+static uint8_t singleBank = 0;
+
+static uint8_t showStats = 0; // print the adapter counters when they are received
+
+/*
+ * The adapter clock is mapped to the host clock from periodic pings.
+ * Each IN ack carries the time of the Endpoint_ClearIN of the credited
+ * packets, which gives the latency from the wheel to the console,
+ * and the pace at which the console takes the reports.
+ * The latency and interval histograms are printed with --stats,
+ * and exported as CSV to histogramFile.
+ */
+#define PING_PERIOD 100000 // us
+#define PING_TIMEOUT 1000000 // us
+#define HIST_BIN_US 250
+
+static const char * histogramFile = NULL;
+static s_clockSync clockSync;
+static s_histogram latencyHist;
+static s_histogram intervalHist;
+static double pingSent = -1; // < 0 means no ping in flight
+static uint32_t lastClearIn = 0;
+static uint8_t hasClearIn = 0;
+
+/*
+ * Wheel receive times of the IN reports in flight to the adapter.
+ */
+static double inFlight[256];
+static uint8_t inFlightHead = 0;
+static uint8_t inFlightTail = 0;
+
+/*
+ * With jit the freshest wheel report is sent a guard time ahead of
+ * the next console poll, instead of as soon as a credit is available. The polls are
+ * predicted from the poll times returned in the IN acks, the guard is
+ * half the average ping round trip, plus the serial transfer time of
+ * the report, plus JIT_MARGIN.
+ * The input age (wheel read to console poll) is measured in both modes.
+ */
+#define JIT_MARGIN 250 // us
+#define JIT_MIN_POLLS 32 // poll intervals observed before scheduling
+
+static uint8_t jit = 0;
+static int jitTimer = -1;
+static uint8_t jitArmed = 0;
+static unsigned int lastInLength = 0;
+
+static struct {
+  double period; // us
+  double last; // adapter time of the last observed poll, in us
+  uint32_t lastClock;
+  unsigned int count;
+} polls = {};
+
+static struct {
+  double received;
+  uint32_t clearIn;
+  uint8_t valid;
+} lastTaken = {}; // the last report the adapter made available to the console
+
+static s_histogram ageHist;
+
+static int jit_locked()
+{
+  return jit && clockSync.valid && polls.count > JIT_MIN_POLLS;
+}
+
+static struct {
+  uint16_t length;
+  unsigned char data[sizeof(s_endpointPacket)];
+} lastInReports[ENDPOINT_MAX_NUMBER] = {};
+
+static struct {
+  unsigned int sent;
+  unsigned int unchanged;
+  unsigned int coalesced; // reports replaced before being sent
+  s_counters adapter;
+} inStats = {};
+
+#define HID_REQ_GET_REPORT 0x01
+#define HID_REPORT_TYPE_FEATURE 3 // high byte of wValue in GET_REPORT
+
+/*
+ * With localHid the adapter answers the standard HID class requests.
+ * The replies to the static feature reports are learned from the first
+ * relayed request, then pushed to the adapter.
+ */
+static uint8_t localHid = 0;
+static uint8_t staticFeatures[256 / 8] = {};
+static uint8_t learnedFeatures[256 / 8] = {};
+static unsigned int featuresSize = 0;
+static struct usb_ctrlrequest pendingSetup = {};
+
+#define FEATURE_IS_SET(TABLE, ID) (TABLE[(ID) / 8] & (1 << ((ID) % 8)))
+#define FEATURE_SET(TABLE, ID) (TABLE[(ID) / 8] |= (1 << ((ID) % 8)))
+
+/*
+ * Replies to the idempotent control requests (GET_DESCRIPTOR and the
+ * selected GET_REPORT ids), keyed on the full setup packet.
+ * A request from the host to the device empties the cache.
+ * ctlTtl is the lifetime of an entry in ms, 0 disables the cache.
+ */
+#define CTL_CACHE_SIZE 16
+
+static unsigned int ctlTtl = 0;
+static uint8_t cachedReports[256 / 8] = {};
+
+static struct {
+  struct usb_ctrlrequest setup;
+  unsigned int time;
+  uint16_t length; // 0 means unused
+  unsigned char data[MAX_PACKET_VALUE_SIZE];
+} ctlCache[CTL_CACHE_SIZE] = {};
 
-static uint8_t inPending = 0;
+static struct {
+  unsigned int hits;
+  unsigned int misses;
+  unsigned int invalidations;
+} ctlStats = {};
 
 static uint8_t serialToUsbEndpoint[2][ENDPOINT_MAX_NUMBER] = {};
 static uint8_t usbToSerialEndpoint[2][ENDPOINT_MAX_NUMBER] = {};
@@ -56,13 +214,40 @@ static uint8_t usbToSerialEndpoint[2][ENDPOINT_MAX_NUMBER] = {};
 #define S2U_ENDPOINT(ENDPOINT) serialToUsbEndpoint[ENDPOINT_DIR_TO_INDEX(ENDPOINT)][ENDPOINT_ADDR_TO_INDEX(ENDPOINT)]
 #define U2S_ENDPOINT(ENDPOINT) usbToSerialEndpoint[ENDPOINT_DIR_TO_INDEX(ENDPOINT)][ENDPOINT_ADDR_TO_INDEX(ENDPOINT)]
 
+/*
+ * Each IN endpoint has a mailbox holding the last wheel report, which
+ * replaces the one not sent yet. The mailboxes are sent in the order
+ * they were filled. The bits set in latchMask (the button bits of the
+ * wheel reports) are latched: the pressed bits of a replaced report are
+ * added to the report that is sent, so a tap between two sends is not
+ * lost, and the actual state follows in the next send.
+ */
 static struct {
-  uint16_t length;
-  s_endpointPacket packet;
+  double time; // when the report was received from the wheel, in us
+  double filled; // when the mailbox was filled, in us
+  uint8_t pending; // the report is not sent yet
+  struct PACKED {
+    s_header header;
+    s_endpointPacket packet;
+  } frame; // ready to be sent
+  unsigned char latched[MAX_PAYLOAD_SIZE_EP]; // pressed bits of the replaced reports
 } inPackets[ENDPOINT_MAX_NUMBER] = {};
 
-static uint8_t inEpFifo[MAX_ENDPOINTS] = {};
-static uint8_t nbInEpFifo = 0;
+/*
+ * With --spoof the wheel reports are converted straight into this frame,
+ * which starts with the default report of the spoofed device.
+ */
+static s_packet spoofFrame = { .header.type = E_TYPE_IN };
+
+/*
+ * The converter of the spoofed device, the generated one with --generated,
+ * NULL if the wheel reports are sent as is.
+ */
+static int (*whlConvert)(char *rep, int rl, char *out) = NULL;
+static uint8_t generated = 0;
+
+static unsigned char latchMask[MAX_PAYLOAD_SIZE_EP] = {};
+static unsigned int latchMaskLength = 0;
 
 static volatile int done;
 
@@ -203,12 +388,117 @@ x00, 0x00, 0x22, 0x00, 0x00, 0xa0, 0x00,
 #define G29_GEAR_SHIFTER_5_MASK  0x10
 #define G29_GEAR_SHIFTER_6_MASK  0x20
 #define G29_GEAR_SHIFTER_R_MASK  0x80
+#define G29_GEAR_SHIFTER_IDX     52
 
 #define G29_ENTER_MASK      0x01
 #define G29_DIAL_DOWN_MASK  0x02
 #define G29_DIAL_UP_MASK    0x04
 #define G29_MINUS_MASK      0x08
 #define G29_PLUS_MASK       0x10
+
+#define G29_WHEEL_IDX       44
+#define G29_GAS_IDX         46
+#define G29_BRAKE_IDX       48
+
+/*
+ * With --decode, the reports of other wheels are decoded into the G29 layout
+ * the converters read. The buttons follow the DualShock 4 order, and the
+ * pedals are at rest at their max, as in the G29 reports.
+ */
+static const s_hidplanTarget whlDecodeTargets[] =
+{
+  { HIDPLAN_AXIS, HID_PAGE_SIMULATION, HID_USAGE_STEERING, G29_WHEEL_IDX, 0 },
+  { HIDPLAN_AXIS, HID_PAGE_DESKTOP, HID_USAGE_X, G29_WHEEL_IDX, 0 },
+  { HIDPLAN_INVERTED_AXIS, HID_PAGE_SIMULATION, HID_USAGE_ACCELERATOR, G29_GAS_IDX, 0 },
+  { HIDPLAN_INVERTED_AXIS, HID_PAGE_DESKTOP, HID_USAGE_Z, G29_GAS_IDX, 0 },
+  { HIDPLAN_INVERTED_AXIS, HID_PAGE_SIMULATION, HID_USAGE_BRAKE, G29_BRAKE_IDX, 0 },
+  { HIDPLAN_INVERTED_AXIS, HID_PAGE_DESKTOP, HID_USAGE_RZ, G29_BRAKE_IDX, 0 },
+  { HIDPLAN_HAT, HID_PAGE_DESKTOP, HID_USAGE_HAT, G29_HB_IDX, 0x0f },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 1, G29_PB_IDX, G29_SQUARE_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 2, G29_PB_IDX, G29_CROSS_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 3, G29_PB_IDX, G29_CIRCLE_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 4, G29_PB_IDX, G29_TRIANGLE_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 5, G29_LB_IDX, G29_L1_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 6, G29_LB_IDX, G29_R1_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 7, G29_LB_IDX, G29_L2_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 8, G29_LB_IDX, G29_R2_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 9, G29_LB_IDX, G29_SHARE_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 10, G29_LB_IDX, G29_OPTIONS_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 11, G29_LB_IDX, G29_L3_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 12, G29_LB_IDX, G29_R3_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 13, G29_PS_IDX, G29_PS_MASK },
+  { HIDPLAN_NONE }
+};
+
+/*
+ * The gears of a shifter input: its buttons 1 to 6 are the gears, its button 7 the reverse.
+ */
+static const s_hidplanTarget gearDecodeTargets[] =
+{
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 1, G29_GEAR_SHIFTER_IDX, G29_GEAR_SHIFTER_1_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 2, G29_GEAR_SHIFTER_IDX, G29_GEAR_SHIFTER_2_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 3, G29_GEAR_SHIFTER_IDX, G29_GEAR_SHIFTER_3_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 4, G29_GEAR_SHIFTER_IDX, G29_GEAR_SHIFTER_4_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 5, G29_GEAR_SHIFTER_IDX, G29_GEAR_SHIFTER_5_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 6, G29_GEAR_SHIFTER_IDX, G29_GEAR_SHIFTER_6_MASK },
+  { HIDPLAN_BUTTON, HID_PAGE_BUTTON, 7, G29_GEAR_SHIFTER_IDX, G29_GEAR_SHIFTER_R_MASK },
+  { HIDPLAN_NONE }
+};
+
+/*
+ * With --decode the wheel reports are decoded into this packet before the conversion,
+ * the bits the plan does not write keep the G29 rest state.
+ */
+static uint8_t decode = 0;
+static s_hidplan whlPlan;
+static s_endpointPacket decodedPacket =
+{
+  .data =
+  {
+    [0] = 0x01, // report id
+    [1 ... 4] = CENTER_AXIS_VALUE_8BITS, // sticks
+    [G29_HB_IDX - 1] = 0x08, // hat
+    [G29_WHEEL_IDX] = CENTER_AXIS_VALUE_16BITS >> 8,
+    [G29_GAS_IDX - 1 ... G29_BRAKE_IDX] = 0xff,
+  }
+};
+
+/*
+ * With --input, other devices (standalone pedals, a shifter) feed the wheel state too:
+ * each has its own decode plan, made of the decode targets of its roles, and the last
+ * report of each is decoded over the wheel report before every conversion: the axes
+ * of an input replace those of the wheel, its buttons and gears are ORed with the
+ * ones of the wheel, and its hat is used when it is not in the null state.
+ * The inputs are polled in the same loop as the wheel, and a report of an input
+ * resends the last wheel report.
+ */
+#define MAX_INPUTS 4
+
+#define INPUT_ROLE_WHEEL   (1 << 0)
+#define INPUT_ROLE_GAS     (1 << 1)
+#define INPUT_ROLE_BRAKE   (1 << 2)
+#define INPUT_ROLE_HAT     (1 << 3)
+#define INPUT_ROLE_BUTTONS (1 << 4)
+#define INPUT_ROLE_GEAR    (1 << 5) // the buttons are the gears of a shifter
+
+static const char * inputRoleNames[] = { "wheel", "gas", "brake", "hat", "buttons", "gear" };
+
+static struct {
+  int vid;
+  int pid;
+  unsigned int roles; // INPUT_ROLE_* bits
+  int usb;
+  uint8_t endpoint; // the IN endpoint of the reports
+  s_hidplan plan;
+  uint8_t report[MAX_PAYLOAD_SIZE_EP]; // the last one
+  unsigned int length; // 0 before the first report
+  double time; // when the last report was received, in us
+} inputs[MAX_INPUTS];
+static unsigned int nbInputs = 0;
+
+static int lastWheelIndex = -1; // the mailbox of the last wheel report
+static double lastWheelTime = 0;
+static s_histogram skewHist; // wheel to input receive time difference of the merged reports
 //--
 #define DF_CROSS_MASK      0x0400
 #define DF_SQUARE_MASK     0x0800
@@ -398,50 +688,114 @@ static s_report_g27Ps3 whl_ps3_g27_report =
 #define WHL_PS3_G27_REPORT_LEN  12
 //--
 
-int spoof_device_index = -1; //spf_0x046d_0xc294_idx; //device spoof index
+// the configuration frames of the spoofed device, built in or from a spoof profile, NULL if not spoofing
+static SPOOF_PKT * spoofFrames = NULL;
+static s_spoofProfile spoofProfile;
+static const char * profileDir = NULL;
+static const char * saveProfileDir = NULL;
+static int spoofVid = 0;
+static int spoofPid = 0;
+
+// the overrides of the descriptors sent to the adapter, and the rewritten frames of the spoofed device
+static s_descRewrite descRewrite = {};
+static unsigned char rewrittenDesc[MAX_DESCRIPTORS_SIZE];
+static s_descriptorIndex rewrittenIndex[MAX_DESCRIPTORS];
+static s_endpointConfig rewrittenEndpoints[MAX_ENDPOINTS];
+static SPOOF_PKT rewrittenFrames[4];
+
+/*
+ * With --mirror, the wheel state is also converted for other adapters, each spoofing
+ * its own device with the generated converter of its handler: each wheel or input report
+ * is converted for the mirrors when it arrives, and sent on the credits of each mirror
+ * adapter, whatever the primary adapter does. The --tty adapter is the primary one: its
+ * force feedback is the only one sent to the wheel, and its control requests the only
+ * ones relayed, the requests of the mirrors that their adapter does not answer are
+ * acked (OUT) or stalled (IN).
+ */
+#define MAX_MIRRORS 4
+
+static struct {
+  int vid;
+  int pid;
+  const char * port;
+  int adapter;
+  s_spoofProfile profile;
+  SPOOF_PKT * frames;
+  int (*convert)(char *rep, int rl, char *out);
+  s_packet frame; // the last converted report, starts with the default report of the device
+  uint16_t checksum; // of the configuration sent
+  uint8_t credits;
+  uint8_t ready;
+  uint8_t pending; // the frame is not sent yet
+  unsigned int sent;
+  unsigned int coalesced; // reports replaced before being sent
+  unsigned int ffbDropped;
+} mirrors[MAX_MIRRORS];
+static unsigned int nbMirrors = 0;
 //
 #if 1
-int whl_ps2_df_convert (char *rep, int rl);
+int whl_ps2_df_convert (char *rep, int rl, char *out);
 int ffb_ps2_df_convert (unsigned char *ffbin, unsigned char *ffbot, int inlen);
-int whl_ps2_dfp_convert (char *rep, int rl);
+int whl_ps2_dfp_convert (char *rep, int rl, char *out);
 int ffb_ps2_dfp_convert (unsigned char *ffbin, unsigned char *ffbot, int inlen);
-int whl_ps3_dfgt_convert (char *rep, int rl);
+int whl_ps3_dfgt_convert (char *rep, int rl, char *out);
 int ffb_ps3_dfgt_convert (unsigned char *ffbin, unsigned char *ffbot, int inlen);
-int whl_ps3_g27_convert (char *rep, int rl);
+int whl_ps3_g27_convert (char *rep, int rl, char *out);
 int ffb_ps3_g27_convert (unsigned char *ffbin, unsigned char *ffbot, int inlen);
 
+// the button and hat remaps of the converters, terminated by an entry with no destination bits
+extern const s_remapEntry whl_ps2_df_remap[];
+extern const s_remapEntry whl_ps2_dfp_remap[];
+extern const s_remapEntry whl_ps3_dfgt_remap[];
+extern const s_remapEntry whl_ps3_g27_remap[];
+
+/*
+ * The remap the converters apply, compiled from the table of the spoofed device,
+ * or from the file given with --remap.
+ */
+static s_remap whlRemap;
+static s_remapEntry customRemap[REMAP_MAX_ENTRIES];
+static int customRemapCount = -1;
+
+static const char * axisNames[AXIS_NB] = { "wheel", "gas", "brake" };
+
+// shaped with --axis, also mapped by the generated converters
+s_axis whlAxes[AXIS_NB] = {
+  [AXIS_WHEEL] = { .config = AXIS_CONFIG_LINEAR, .centered = 1 },
+  [AXIS_GAS] = { .config = AXIS_CONFIG_LINEAR, .inverted = 1 },
+  [AXIS_BRAKE] = { .config = AXIS_CONFIG_LINEAR, .inverted = 1 },
+};
+
 typedef struct {
   int vid;
   int pid;
-  int (*whl)(char *rep, int rl);
+  int (*whl)(char *rep, int rl, char *out); // converts rep into out, which holds whl_report initially
   int (*ffb)(unsigned char *ffbin, unsigned char *ffbot, int inlen);
   char *whl_report;
+  int whl_report_len;
+  const s_remapEntry *whl_remap;
+  long whl_axes[AXIS_NB]; // the output maxima whl maps the axes to
   int ffb_out_ep;
   char *pdv;
 } proc_list;
 
 proc_list spoof_handlers[] = {
     //PS4:Fanatec CSL Elite Pro
-    {0x0EB7, 0x0E04, NULL, NULL, NULL, 0x03, "PS4:Fanatec CSL Elite Pro",},
+    {0x0EB7, 0x0E04, NULL, NULL, NULL, 0, NULL, {0}, 0x03, "PS4:Fanatec CSL Elite Pro",},
     //PS2:Logitech Driving Force
-    {0x046D, 0xC294, whl_ps2_df_convert, ffb_ps2_df_convert, (char *)&whl_ps2_df_report, 0x03, "PS2:Logitech Driving Force",},
+    {0x046D, 0xC294, whl_ps2_df_convert, ffb_ps2_df_convert, (char *)&whl_ps2_df_report, WHL_PS2_DF_REPORT_LEN, whl_ps2_df_remap, {MAX_AXIS_VALUE_10BITS, MAX_AXIS_VALUE_8BITS, MAX_AXIS_VALUE_8BITS}, 0x03, "PS2:Logitech Driving Force",},
     //PS2:Logitech Driving Force Pro
-    {0x046D, 0xC298, whl_ps2_dfp_convert, ffb_ps2_dfp_convert, (char *)&whl_ps2_dfp_report, 0x03, "PS2:Logitech Driving Force Pro",},
+    {0x046D, 0xC298, whl_ps2_dfp_convert, ffb_ps2_dfp_convert, (char *)&whl_ps2_dfp_report, WHL_PS2_DFP_REPORT_LEN, whl_ps2_dfp_remap, {MAX_AXIS_VALUE_14BITS, MAX_AXIS_VALUE_8BITS, MAX_AXIS_VALUE_8BITS}, 0x03, "PS2:Logitech Driving Force Pro",},
     //PS3:Logitech Driving Force GT
-    {0x046D, 0xC29A, whl_ps3_dfgt_convert, ffb_ps3_dfgt_convert, (char *)&whl_ps3_dfgt_report, 0x03, "PS3:Logitech Driving Force GT",},
+    {0x046D, 0xC29A, whl_ps3_dfgt_convert, ffb_ps3_dfgt_convert, (char *)&whl_ps3_dfgt_report, WHL_PS3_DFGT_REPORT_LEN, whl_ps3_dfgt_remap, {MAX_AXIS_VALUE_14BITS, MAX_AXIS_VALUE_8BITS, MAX_AXIS_VALUE_8BITS}, 0x03, "PS3:Logitech Driving Force GT",},
     //PS3:Logitech G27
-    {0x046D, 0xC29B, whl_ps3_g27_convert, ffb_ps3_g27_convert, (char *)&whl_ps3_g27_report, 0x03, "PS3:Logitech G27",},
-    {0x0000, 0x0000, NULL, NULL, NULL, 0x00, NULL},
+    {0x046D, 0xC29B, whl_ps3_g27_convert, ffb_ps3_g27_convert, (char *)&whl_ps3_g27_report, WHL_PS3_G27_REPORT_LEN, whl_ps3_g27_remap, {MAX_AXIS_VALUE_14BITS, MAX_AXIS_VALUE_8BITS, MAX_AXIS_VALUE_8BITS}, 0x03, "PS3:Logitech G27",},
+    {0x0000, 0x0000, NULL, NULL, NULL, 0, NULL, {0}, 0x00, NULL},
 };
 int spoof_handlers_index = -1;
 char *whl_report = NULL;
 #endif
 //
-typedef struct spoof_pkt {
-  unsigned char type;
-  unsigned int  len;
-  unsigned char pkt[512];
-} SPOOF_PKT;
 
 static SPOOF_PKT devs_spoof[] = {
   //Fanatec CSL Elite Pro - PS4
@@ -454,39 +808,39 @@ static SPOOF_PKT devs_spoof[] = {
   //#s2u[1]: 00 00 00 84 00 00 00 00 00 00 00 00 00 00 00                                  
   //#u2s[1]: 00 00 00 84 00 00 00 00 00 00 00 00 00 00 00 
   //VID&PID debug message
-  {E_TYPE_DEBUG, 0x06, {0x0E, 0xB7, 0x0E, 0x04, 0x81, 0x03}},
+  {E_TYPE_DEBUG, 0x06, (unsigned char []){0x0E, 0xB7, 0x0E, 0x04, 0x81, 0x03}},
   //0: descriptors
   //#i.DAT@0000: 0x00, 0x145, 0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0xb7, 0x0e, 0x04, 0x0e, 0x76, 0x04, 0x01, 0x09, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x11, 0x01, 0x21, 0x01, 0x22, 0xa0, 0x00, 0x07, 0x05, 0x03, 0x03, 0x40, 0x00, 0x05, 0x07, 0x05, 0x84, 0x03, 0x40, 0x00, 0x05, 0x10, 0x03, 0x46, 0x00, 0x61, 0x00, 0x6e, 0x00, 0x61, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x56, 0x03, 0x46, 0x00, 0x41, 0x00, 0x4e, 0x00, 0x41, 0x00, 0x54, 0x00, 0x45, 0x00, 0x43, 0x00, 0x20, 0x00, 0x43, 0x00, 0x53, 0x00, 0x4c, 0x00, 0x20, 0x00, 0x45, 0x00, 0x6c, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x20, 0x00, 0x42, 0x00, 0x61, 0x00, 0x73, 0x00, 0x65, 0x00, 0x20, 0x00, 0x50, 0x00, 0x6c, 0x00, 0x61, 0x00, 0x79, 0x00, 0x53, 0x00, 0x74, 0x00, 0x61, 0x00, 0x74, 0x00, 0x69, 0x00, 0x6f, 0x00, 0x6e, 0x00, 0x20, 0x00, 0x34, 0x00, 0x05, 0x01, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02, 0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3b, 0x01, 0x65, 0x14, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, 0x65, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0e, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x20, 0x75, 0x06, 0x95, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x33, 0x09, 0x34, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x02, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x21, 0x95, 0x36, 0x81, 0x02, 0x85, 0x05, 0x09, 0x22, 0x95, 0x1f, 0x91, 0x02, 0x85, 0x03, 0x0a, 0x21, 0x27, 0x95, 0x2f, 0xb1, 0x02, 0xc0, 0x06, 0xf0, 0xff, 0x09, 0x40, 0xa1, 0x01, 0x85, 0xf0, 0x09, 0x47, 0x95, 0x3f, 0xb1, 0x02, 0x85, 0xf1, 0x09, 0x48, 0x95, 0x3f, 0xb1, 0x02, 0x85, 0xf2, 0x09, 0x49, 0x95, 0x0f, 0xb1, 0x02, 0x85, 0xf3, 0x0a, 0x01, 0x47, 0x95, 0x07, 0xb1, 0x02, 0xc0,
-  {0x00, 0x145, {0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0xb7, 0x0e, 0x04, 0x0e, 0x76, 0x04, 0x01, 0x09, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x11, 0x01, 0x21, 0x01, 0x22, 0xa0, 0x00, 0x07, 0x05, 0x03, 0x03, 0x40, 0x00, 0x05, 0x07, 0x05, 0x84, 0x03, 0x40, 0x00, 0x05, 0x10, 0x03, 0x46, 0x00, 0x61, 0x00, 0x6e, 0x00, 0x61, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x56, 0x03, 0x46, 0x00, 0x41, 0x00, 0x4e, 0x00, 0x41, 0x00, 0x54, 0x00, 0x45, 0x00, 0x43, 0x00, 0x20, 0x00, 0x43, 0x00, 0x53, 0x00, 0x4c, 0x00, 0x20, 0x00, 0x45, 0x00, 0x6c, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x20, 0x00, 0x42, 0x00, 0x61, 0x00, 0x73, 0x00, 0x65, 0x00, 0x20, 0x00, 0x50, 0x00, 0x6c, 0x00, 0x61, 0x00, 0x79, 0x00, 0x53, 0x00, 0x74, 0x00, 0x61, 0x00, 0x74, 0x00, 0x69, 0x00, 0x6f, 0x00, 0x6e, 0x00, 0x20, 0x00, 0x34, 0x00, 0x05, 0x01, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02, 0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3b, 0x01, 0x65, 0x14, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, 0x65, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0e, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x20, 0x75, 0x06, 0x95, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x33, 0x09, 0x34, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x02, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x21, 0x95, 0x36, 0x81, 0x02, 0x85, 0x05, 0x09, 0x22, 0x95, 0x1f, 0x91, 0x02, 0x85, 0x03, 0x0a, 0x21, 0x27, 0x95, 0x2f, 0xb1, 0x02, 0xc0, 0x06, 0xf0, 0xff, 0x09, 0x40, 0xa1, 0x01, 0x85, 0xf0, 0x09, 0x47, 0x95, 0x3f, 0xb1, 0x02, 0x85, 0xf1, 0x09, 0x48, 0x95, 0x3f, 0xb1, 0x02, 0x85, 0xf2, 0x09, 0x49, 0x95, 0x0f, 0xb1, 0x02, 0x85, 0xf3, 0x0a, 0x01, 0x47, 0x95, 0x07, 0xb1, 0x02, 0xc0,}},
+  {0x00, 0x145, (unsigned char []){0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0xb7, 0x0e, 0x04, 0x0e, 0x76, 0x04, 0x01, 0x09, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x11, 0x01, 0x21, 0x01, 0x22, 0xa0, 0x00, 0x07, 0x05, 0x03, 0x03, 0x40, 0x00, 0x05, 0x07, 0x05, 0x84, 0x03, 0x40, 0x00, 0x05, 0x10, 0x03, 0x46, 0x00, 0x61, 0x00, 0x6e, 0x00, 0x61, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x56, 0x03, 0x46, 0x00, 0x41, 0x00, 0x4e, 0x00, 0x41, 0x00, 0x54, 0x00, 0x45, 0x00, 0x43, 0x00, 0x20, 0x00, 0x43, 0x00, 0x53, 0x00, 0x4c, 0x00, 0x20, 0x00, 0x45, 0x00, 0x6c, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x20, 0x00, 0x42, 0x00, 0x61, 0x00, 0x73, 0x00, 0x65, 0x00, 0x20, 0x00, 0x50, 0x00, 0x6c, 0x00, 0x61, 0x00, 0x79, 0x00, 0x53, 0x00, 0x74, 0x00, 0x61, 0x00, 0x74, 0x00, 0x69, 0x00, 0x6f, 0x00, 0x6e, 0x00, 0x20, 0x00, 0x34, 0x00, 0x05, 0x01, 0x09, 0x05, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02, 0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3b, 0x01, 0x65, 0x14, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, 0x65, 0x00, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0e, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x20, 0x75, 0x06, 0x95, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x33, 0x09, 0x34, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x02, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x21, 0x95, 0x36, 0x81, 0x02, 0x85, 0x05, 0x09, 0x22, 0x95, 0x1f, 0x91, 0x02, 0x85, 0x03, 0x0a, 0x21, 0x27, 0x95, 0x2f, 0xb1, 0x02, 0xc0, 0x06, 0xf0, 0xff, 0x09, 0x40, 0xa1, 0x01, 0x85, 0xf0, 0x09, 0x47, 0x95, 0x3f, 0xb1, 0x02, 0x85, 0xf1, 0x09, 0x48, 0x95, 0x3f, 0xb1, 0x02, 0x85, 0xf2, 0x09, 0x49, 0x95, 0x0f, 0xb1, 0x02, 0x85, 0xf3, 0x0a, 0x01, 0x47, 0x95, 0x07, 0xb1, 0x02, 0xc0,}},
   //#i.DAT@0000: 0x01, 0x30, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x01, 0x03, 0x09, 0x04, 0x10, 0x00, 0x4f, 0x00, 0x09, 0x03, 0x09, 0x04, 0x56, 0x00, 0xa5, 0x00, 0x00, 0x22, 0x00, 0x00, 0xa0, 0x00,
   //1: index
-  {0x01, 0x30, {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x01, 0x03, 0x09, 0x04, 0x10, 0x00, 0x4f, 0x00, 0x09, 0x03, 0x09, 0x04, 0x56, 0x00, 0xa5, 0x00, 0x00, 0x22, 0x00, 0x00, 0xa0, 0x00,}},
+  {0x01, 0x30, (unsigned char []){0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x01, 0x03, 0x09, 0x04, 0x10, 0x00, 0x4f, 0x00, 0x09, 0x03, 0x09, 0x04, 0x56, 0x00, 0xa5, 0x00, 0x00, 0x22, 0x00, 0x00, 0xa0, 0x00,}},
   //#i:ready descriptors
   //#i:ready descriptors
   //#i.DAT@0000: 0x02, 0x06, 0x03, 0x03, 0x40, 0x84, 0x03, 0x40,
   //2: endpoints
-  {0x02, 0x06, {0x03, 0x03, 0x40, 0x84, 0x03, 0x40,}},
+  {0x02, 0x08, (unsigned char []){0x03, 0x03, 0x40, 0x00, 0x84, 0x03, 0x40, 0x00,}},
   //3:reset to end the chain
-  {E_TYPE_RESET, 0x00, {0x00}},
+  {E_TYPE_RESET, 0x00, NULL},
   //Logitech Driving Force - PS2
   //#i:using device: VID 0x046d PID 0xc294 PATH 01:01:01:02
   //opt: --spoof 046D:C294
   //VID&PID debug message
-  {E_TYPE_DEBUG, 0x06, {0x04, 0x6D, 0xC2, 0x94, 0x81, 0x03}},
+  {E_TYPE_DEBUG, 0x06, (unsigned char []){0x04, 0x6D, 0xC2, 0x94, 0x81, 0x03}},
   //#i:sending descriptors
   //#i.DAT@0000: 0x00, 0x103, 0x12, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x6d, 0x04, 0x94, 0xc2, 0x00, 0x00, 0x03, 0x01, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x00, 0x01, 0x21, 0x01, 0x22, 0x84, 0x00, 0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0a, 0x07, 0x05, 0x02, 0x03, 0x08, 0x00, 0x0a, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x2e, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x20, 0x00, 0x44, 0x00, 0x72, 0x00, 0x69, 0x00, 0x76, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x46, 0x00, 0x6f, 0x00, 0x72, 0x00, 0x63, 0x00, 0x65, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x14, 0x26, 0xff, 0x03, 0x34, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x05, 0x01, 0x95, 0x01, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x31, 0x81, 0x02, 0x09, 0x35, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0xc0, 0xc0,
   //0: descriptors
-  {0x00, 0x103, {0x12, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x6d, 0x04, 0x94, 0xc2, 0x00, 0x00, 0x03, 0x01, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x00, 0x01, 0x21, 0x01, 0x22, 0x84, 0x00, 0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0a, 0x07, 0x05, 0x02, 0x03, 0x08, 0x00, 0x0a, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x2e, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x20, 0x00, 0x44, 0x00, 0x72, 0x00, 0x69, 0x00, 0x76, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x46, 0x00, 0x6f, 0x00, 0x72, 0x00, 0x63, 0x00, 0x65, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x14, 0x26, 0xff, 0x03, 0x34, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x05, 0x01, 0x95, 0x01, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x31, 0x81, 0x02, 0x09, 0x35, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0xc0, 0xc0,}},
+  {0x00, 0x103, (unsigned char []){0x12, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x6d, 0x04, 0x94, 0xc2, 0x00, 0x00, 0x03, 0x01, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x00, 0x01, 0x21, 0x01, 0x22, 0x84, 0x00, 0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0a, 0x07, 0x05, 0x02, 0x03, 0x08, 0x00, 0x0a, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x2e, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x20, 0x00, 0x44, 0x00, 0x72, 0x00, 0x69, 0x00, 0x76, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x46, 0x00, 0x6f, 0x00, 0x72, 0x00, 0x63, 0x00, 0x65, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x14, 0x26, 0xff, 0x03, 0x34, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x05, 0x01, 0x95, 0x01, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x31, 0x81, 0x02, 0x09, 0x35, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0xc0, 0xc0,}},
   //#i.DAT@0000: 0x01, 0x30, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x03, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x01, 0x03, 0x09, 0x04, 0x2e, 0x00, 0x7f, 0x00, 0x00, 0x22, 0x00, 0x00, 0x84, 0x00,
   //1: index
-  {0x01, 0x30, {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x03, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x01, 0x03, 0x09, 0x04, 0x2e, 0x00, 0x7f, 0x00, 0x00, 0x22, 0x00, 0x00, 0x84, 0x00,}},
+  {0x01, 0x30, (unsigned char []){0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x03, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x01, 0x03, 0x09, 0x04, 0x2e, 0x00, 0x7f, 0x00, 0x00, 0x22, 0x00, 0x00, 0x84, 0x00,}},
   //#i:ready descriptors
   //#i:ready descriptors
   //#i.DAT@0000: 0x02, 0x06, 0x81, 0x03, 0x08, 0x02, 0x03, 0x08,
   //2: endpoints
-  {0x02, 0x06, {0x81, 0x03, 0x08, 0x02, 0x03, 0x08,}},
+  {0x02, 0x08, (unsigned char []){0x81, 0x03, 0x08, 0x00, 0x02, 0x03, 0x08, 0x00,}},
   //3:reset to end the chain
-  {E_TYPE_RESET, 0x00, {0x00}},
+  {E_TYPE_RESET, 0x00, NULL},
   //---------------------------------------------------------------------------
   //Logitech Driving Force Pro - PS2
 /*
@@ -521,23 +875,23 @@ endpoint: OUT INTERRUPT 2
   //#i:using device: VID 0x046d PID 0xc298 PATH 01:01:01:02
   //opt: --spoof 046D:C298
   //VID&PID debug message
-  {E_TYPE_DEBUG, 0x06, {0x04, 0x6D, 0xC2, 0x98, 0x81, 0x03}},
+  {E_TYPE_DEBUG, 0x06, (unsigned char []){0x04, 0x6D, 0xC2, 0x98, 0x81, 0x03}},
   //#i:sending descriptors
   //#PKT:232 bytes, type 0
   //##0x12, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x6d, 0x04, 0x98, 0xc2, 0x06, 0x11, 0x03, 0x01, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x00, 0x01, 0x21, 0x01, 0x22, 0x61, 0x00, 0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0a, 0x07, 0x05, 0x02, 0x03, 0x08, 0x00, 0x0a, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x36, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x20, 0x00, 0x44, 0x00, 0x72, 0x00, 0x69, 0x00, 0x76, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x46, 0x00, 0x6f, 0x00, 0x72, 0x00, 0x63, 0x00, 0x65, 0x00, 0x20, 0x00, 0x50, 0x00, 0x72, 0x00, 0x6f, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0e, 0x15, 0x00, 0x26, 0xff, 0x3f, 0x35, 0x00, 0x46, 0xff, 0x3f, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0e, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x81, 0x02, 0x05, 0x01, 0x95, 0x01, 0x75, 0x04, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x65, 0x00, 0x95, 0x01, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x31, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x00, 0x95, 0x03, 0x75, 0x08, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x09, 0x02, 0x95, 0x07, 0x91, 0x02, 0xc0, 0xc0,
   //0: descriptors
-  {0x00, 0xe8, {0x12, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x6d, 0x04, 0x98, 0xc2, 0x06, 0x11, 0x03, 0x01, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x00, 0x01, 0x21, 0x01, 0x22, 0x61, 0x00, 0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0a, 0x07, 0x05, 0x02, 0x03, 0x08, 0x00, 0x0a, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x36, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x20, 0x00, 0x44, 0x00, 0x72, 0x00, 0x69, 0x00, 0x76, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x46, 0x00, 0x6f, 0x00, 0x72, 0x00, 0x63, 0x00, 0x65, 0x00, 0x20, 0x00, 0x50, 0x00, 0x72, 0x00, 0x6f, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0e, 0x15, 0x00, 0x26, 0xff, 0x3f, 0x35, 0x00, 0x46, 0xff, 0x3f, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0e, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x81, 0x02, 0x05, 0x01, 0x95, 0x01, 0x75, 0x04, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x65, 0x00, 0x95, 0x01, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x31, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x00, 0x95, 0x03, 0x75, 0x08, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x09, 0x02, 0x95, 0x07, 0x91, 0x02, 0xc0, 0xc0,}},
+  {0x00, 0xe8, (unsigned char []){0x12, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, 0x6d, 0x04, 0x98, 0xc2, 0x06, 0x11, 0x03, 0x01, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0x80, 0x28, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x00, 0x01, 0x21, 0x01, 0x22, 0x61, 0x00, 0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x0a, 0x07, 0x05, 0x02, 0x03, 0x08, 0x00, 0x0a, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x36, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x20, 0x00, 0x44, 0x00, 0x72, 0x00, 0x69, 0x00, 0x76, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x46, 0x00, 0x6f, 0x00, 0x72, 0x00, 0x63, 0x00, 0x65, 0x00, 0x20, 0x00, 0x50, 0x00, 0x72, 0x00, 0x6f, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0e, 0x15, 0x00, 0x26, 0xff, 0x3f, 0x35, 0x00, 0x46, 0xff, 0x3f, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0e, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x81, 0x02, 0x05, 0x01, 0x95, 0x01, 0x75, 0x04, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x65, 0x00, 0x95, 0x01, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x31, 0x81, 0x02, 0x06, 0x00, 0xff, 0x09, 0x00, 0x95, 0x03, 0x75, 0x08, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x09, 0x02, 0x95, 0x07, 0x91, 0x02, 0xc0, 0xc0,}},
   //#PKT:048 bytes, type 1
   //##0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x03, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x01, 0x03, 0x09, 0x04, 0x36, 0x00, 0x87, 0x00, 0x00, 0x22, 0x00, 0x00, 0x61, 0x00,
   //1: index
-  {0x01, 0x30, {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x03, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x01, 0x03, 0x09, 0x04, 0x36, 0x00, 0x87, 0x00, 0x00, 0x22, 0x00, 0x00, 0x61, 0x00,}},
+  {0x01, 0x30, (unsigned char []){0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x03, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x01, 0x03, 0x09, 0x04, 0x36, 0x00, 0x87, 0x00, 0x00, 0x22, 0x00, 0x00, 0x61, 0x00,}},
   //#i:ready descriptors
   //#PKT:006 bytes, type 2
   //##0x81, 0x03, 0x08, 0x02, 0x03, 0x08,
   //2: endpoints
-  {0x02, 0x06, {0x81, 0x03, 0x08, 0x02, 0x03, 0x08,}},
+  {0x02, 0x08, (unsigned char []){0x81, 0x03, 0x08, 0x00, 0x02, 0x03, 0x08, 0x00,}},
   //3:reset to end the chain
-  {E_TYPE_RESET, 0x00, {0x00}},
+  {E_TYPE_RESET, 0x00, NULL},
   //---------------------------------------------------------------------------
   //Logitech Driving Force GT - PS3 mode
 #if 0
@@ -607,17 +961,17 @@ button map
   //#s2u[1]: 81 00 00 00 00 00 00 00 00 00 00 00 00 00 00
   //#u2s[1]: 81 00 00 00 00 00 00 00 00 00 00 00 00 00 00
   //VID&PID debug message
-  {E_TYPE_DEBUG, 0x06, {0x04, 0x6D, 0xC2, 0x9A, 0x81, 0x03}},
+  {E_TYPE_DEBUG, 0x06, (unsigned char []){0x04, 0x6D, 0xC2, 0x9A, 0x81, 0x03}},
   //#i:sending descriptors
   //#i.WHL@0000: 0x00, 0xE6, 0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x6d, 0x04, 0x9a, 0xc2, 0x26, 0x13, 0x00, 0x02, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0xc0, 0x32, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0xfe, 0x09, 0x21, 0x11, 0x01, 0x21, 0x01, 0x22, 0x85, 0x00, 0x07, 0x05, 0x81, 0x03, 0x10, 0x00, 0x02, 0x07, 0x05, 0x02, 0x03, 0x10, 0x00, 0x02, 0x22, 0x03, 0x47, 0x00, 0x32, 0x00, 0x37, 0x00, 0x20, 0x00, 0x52, 0x00, 0x61, 0x00, 0x63, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x15, 0x00, 0x26, 0xff, 0x03, 0x35, 0x00, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x31, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x95, 0x02, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x02, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0x00, 0x00, 0x00, 0xc0, 0xc0,
-  {0x00, 0xE6, {0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x6d, 0x04, 0x9a, 0xc2, 0x26, 0x13, 0x00, 0x02, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0xc0, 0x32, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0xfe, 0x09, 0x21, 0x11, 0x01, 0x21, 0x01, 0x22, 0x85, 0x00, 0x07, 0x05, 0x81, 0x03, 0x10, 0x00, 0x02, 0x07, 0x05, 0x02, 0x03, 0x10, 0x00, 0x02, 0x22, 0x03, 0x47, 0x00, 0x32, 0x00, 0x37, 0x00, 0x20, 0x00, 0x52, 0x00, 0x61, 0x00, 0x63, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x15, 0x00, 0x26, 0xff, 0x03, 0x35, 0x00, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x31, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x95, 0x02, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x02, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0x00, 0x00, 0x00, 0xc0, 0xc0,}},
+  {0x00, 0xE6, (unsigned char []){0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x6d, 0x04, 0x9a, 0xc2, 0x26, 0x13, 0x00, 0x02, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0xc0, 0x32, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0xfe, 0x09, 0x21, 0x11, 0x01, 0x21, 0x01, 0x22, 0x85, 0x00, 0x07, 0x05, 0x81, 0x03, 0x10, 0x00, 0x02, 0x07, 0x05, 0x02, 0x03, 0x10, 0x00, 0x02, 0x22, 0x03, 0x47, 0x00, 0x32, 0x00, 0x37, 0x00, 0x20, 0x00, 0x52, 0x00, 0x61, 0x00, 0x63, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x15, 0x00, 0x26, 0xff, 0x03, 0x35, 0x00, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x31, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x95, 0x02, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x02, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0x00, 0x00, 0x00, 0xc0, 0xc0,}},
   //#i.WHL@0000: 0x01, 0x28, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x02, 0x03, 0x09, 0x04, 0x22, 0x00, 0x61, 0x00, 0x00, 0x22, 0x00, 0x00, 0x85, 0x00,
-  {0x01, 0x28, {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x02, 0x03, 0x09, 0x04, 0x22, 0x00, 0x61, 0x00, 0x00, 0x22, 0x00, 0x00, 0x85, 0x00,}},
+  {0x01, 0x28, (unsigned char []){0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x02, 0x03, 0x09, 0x04, 0x22, 0x00, 0x61, 0x00, 0x00, 0x22, 0x00, 0x00, 0x85, 0x00,}},
   //#i:ready descriptors
   //#i.WHL@0000: 0x02, 0x06, 0x81, 0x03, 0x10, 0x02, 0x03, 0x10,
-  {0x02, 0x06, {0x81, 0x03, 0x10, 0x02, 0x03, 0x10,}},
+  {0x02, 0x08, (unsigned char []){0x81, 0x03, 0x10, 0x00, 0x02, 0x03, 0x10, 0x00,}},
   //3:reset to end the chain
-  {E_TYPE_RESET, 0x00, {0x00}},
+  {E_TYPE_RESET, 0x00, NULL},
   //---------------------------------------------------------------------------
   //Logitech G27 - PS3 mode
 #if 0
@@ -708,7 +1062,7 @@ static struct
   //#i:using device: VID 0x046d PID 0xc29b PATH 01:01:01:02
   //opt: --spoof 046D:C29B
   //VID&PID debug message
-  {E_TYPE_DEBUG, 0x06, {0x04, 0x6D, 0xC2, 0x9B, 0x81, 0x03}},
+  {E_TYPE_DEBUG, 0x06, (unsigned char []){0x04, 0x6D, 0xC2, 0x9B, 0x81, 0x03}},
   //endpoint: IN INTERRUPT 1
   //endpoint: OUT INTERRUPT 2
   //#s2u[0]: 00 02 00 00 00 00 00 00 00 00 00 00 00 00 00
@@ -717,15 +1071,15 @@ static struct
   //#u2s[1]: 81 00 00 00 00 00 00 00 00 00 00 00 00 00 00
   //#i:sending descriptors
   //#i.WHL@0000: 0x00, 0xF8, 0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x6d, 0x04, 0x9b, 0xc2, 0x38, 0x12, 0x01, 0x02, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0xc0, 0x32, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x85, 0x00, 0x07, 0x05, 0x81, 0x03, 0x10, 0x00, 0x02, 0x07, 0x05, 0x02, 0x03, 0x10, 0x00, 0x02, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x22, 0x03, 0x47, 0x00, 0x32, 0x00, 0x37, 0x00, 0x20, 0x00, 0x52, 0x00, 0x61, 0x00, 0x63, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x15, 0x00, 0x26, 0xff, 0x03, 0x35, 0x00, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x31, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x95, 0x02, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x02, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0x00, 0x00, 0x00, 0xc0, 0xc0,
-  {0x00, 0xF8, {0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x6d, 0x04, 0x9b, 0xc2, 0x38, 0x12, 0x01, 0x02, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0xc0, 0x32, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x85, 0x00, 0x07, 0x05, 0x81, 0x03, 0x10, 0x00, 0x02, 0x07, 0x05, 0x02, 0x03, 0x10, 0x00, 0x02, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x22, 0x03, 0x47, 0x00, 0x32, 0x00, 0x37, 0x00, 0x20, 0x00, 0x52, 0x00, 0x61, 0x00, 0x63, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x15, 0x00, 0x26, 0xff, 0x03, 0x35, 0x00, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x31, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x95, 0x02, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x02, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0x00, 0x00, 0x00, 0xc0, 0xc0,}},
+  {0x00, 0xF8, (unsigned char []){0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x6d, 0x04, 0x9b, 0xc2, 0x38, 0x12, 0x01, 0x02, 0x00, 0x01, 0x04, 0x03, 0x09, 0x04, 0x09, 0x02, 0x29, 0x00, 0x01, 0x01, 0x00, 0xc0, 0x32, 0x09, 0x04, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x85, 0x00, 0x07, 0x05, 0x81, 0x03, 0x10, 0x00, 0x02, 0x07, 0x05, 0x02, 0x03, 0x10, 0x00, 0x02, 0x12, 0x03, 0x4c, 0x00, 0x6f, 0x00, 0x67, 0x00, 0x69, 0x00, 0x74, 0x00, 0x65, 0x00, 0x63, 0x00, 0x68, 0x00, 0x22, 0x03, 0x47, 0x00, 0x32, 0x00, 0x37, 0x00, 0x20, 0x00, 0x52, 0x00, 0x61, 0x00, 0x63, 0x00, 0x69, 0x00, 0x6e, 0x00, 0x67, 0x00, 0x20, 0x00, 0x57, 0x00, 0x68, 0x00, 0x65, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0xa1, 0x02, 0x95, 0x01, 0x75, 0x0a, 0x15, 0x00, 0x26, 0xff, 0x03, 0x35, 0x00, 0x46, 0xff, 0x03, 0x09, 0x30, 0x81, 0x02, 0x95, 0x0c, 0x75, 0x01, 0x25, 0x01, 0x45, 0x01, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0c, 0x81, 0x02, 0x95, 0x02, 0x06, 0x00, 0xff, 0x09, 0x01, 0x81, 0x02, 0x05, 0x01, 0x09, 0x31, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x01, 0x75, 0x08, 0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x75, 0x01, 0x95, 0x04, 0x65, 0x00, 0x06, 0x00, 0xff, 0x09, 0x01, 0x25, 0x01, 0x45, 0x01, 0x81, 0x02, 0x95, 0x02, 0x75, 0x08, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x02, 0x81, 0x02, 0xc0, 0xa1, 0x02, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x95, 0x07, 0x75, 0x08, 0x09, 0x03, 0x91, 0x02, 0x00, 0x00, 0x00, 0xc0, 0xc0,}},
   //#i.WHL@0000: 0x01, 0x30, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x01, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x02, 0x03, 0x09, 0x04, 0x22, 0x00, 0x73, 0x00, 0x00, 0x22, 0x00, 0x00, 0x85, 0x00,
-  {0x01, 0x30, {0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x01, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x02, 0x03, 0x09, 0x04, 0x22, 0x00, 0x73, 0x00, 0x00, 0x22, 0x00, 0x00, 0x85, 0x00,}},
+  {0x01, 0x30, (unsigned char []){0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00, 0x12, 0x00, 0x00, 0x03, 0x00, 0x00, 0x04, 0x00, 0x16, 0x00, 0x00, 0x02, 0x00, 0x00, 0x29, 0x00, 0x3f, 0x00, 0x01, 0x03, 0x09, 0x04, 0x12, 0x00, 0x51, 0x00, 0x02, 0x03, 0x09, 0x04, 0x22, 0x00, 0x73, 0x00, 0x00, 0x22, 0x00, 0x00, 0x85, 0x00,}},
   //#i:ready descriptors
   //#i.WHL@0000: 0x02, 0x06, 0x81, 0x03, 0x10, 0x02, 0x03, 0x10,
-  {0x02, 0x06, {0x81, 0x03, 0x10, 0x02, 0x03, 0x10,}},
+  {0x02, 0x08, (unsigned char []){0x81, 0x03, 0x10, 0x00, 0x02, 0x03, 0x10, 0x00,}},
   //#i:ready indexes
   //3:reset to end the chain
-  {E_TYPE_RESET, 0x00, {0x00}},
+  {E_TYPE_RESET, 0x00, NULL},
 };
 
 int get_spoof_idx (int vid, int pid)
@@ -753,18 +1107,47 @@ int get_spoof_idx (int vid, int pid)
   return ret;
 }
 
-int set_spoof_device (int vid, int pid)
+/*
+ * Find the configuration frames of a spoofed device, in the profile directory or in the
+ * built-in identities, and the index of its handler, -1 if it has none.
+ *
+ * \return the frames, NULL if the device is unknown
+ */
+static SPOOF_PKT * find_spoof_device (int vid, int pid, s_spoofProfile * profile, int * handler)
 {
-  spoof_device_index = get_spoof_idx (vid, pid);
-  if (-1 == spoof_device_index)
-    return -1;
+  int handlerVid = vid;
+  int handlerPid = pid;
+  SPOOF_PKT * frames = NULL;
+  if (profileDir != NULL)
+  {
+    // the profile directory overrides the built-in identities
+    int status = spoof_profile_load (profileDir, vid, pid, profile);
+    if (status < 0)
+    {
+      return NULL;
+    }
+    if (status == 0)
+    {
+      printf ("\n#i:using the spoof profile of %04x:%04x from %s", vid, pid, profileDir);
+      frames = profile->frames;
+      handlerVid = profile->handlerVid;
+      handlerPid = profile->handlerPid;
+    }
+  }
+  if (frames == NULL)
+  {
+    int index = get_spoof_idx (vid, pid);
+    if (-1 == index)
+      return NULL;
+    frames = devs_spoof + index;
+  }
   //
   int lk = 0, ret = -1;
   int spdl = sizeof(spoof_handlers)/sizeof(proc_list);
   printf("\n#scanning %d spoof handlers", spdl);
   while (lk < spdl)
   {
-    if (spoof_handlers[lk].vid == vid && spoof_handlers[lk].pid == pid)
+    if (spoof_handlers[lk].vid == handlerVid && spoof_handlers[lk].pid == handlerPid)
     {
       printf ("\n#found spoof handler at %d", lk);
       ret = lk;
@@ -772,15 +1155,32 @@ int set_spoof_device (int vid, int pid)
     }
     lk++;
   }
+  *handler = ret;
+  return frames;
+}
+
+int set_spoof_device (int vid, int pid)
+{
+  spoof_profile_unload (&spoofProfile);
+  int handler;
+  spoofFrames = find_spoof_device (vid, pid, &spoofProfile, &handler);
+  if (spoofFrames == NULL)
+  {
+    return -1;
+  }
+  spoofVid = vid;
+  spoofPid = pid;
   //
-  spoof_handlers_index = ret;
+  spoof_handlers_index = handler;
   if (-1 != spoof_handlers_index)
   {
     whl_report = spoof_handlers[spoof_handlers_index].whl_report;
+    memcpy (spoofFrame.value, whl_report, spoof_handlers[spoof_handlers_index].whl_report_len);
+    spoofFrame.header.length = spoof_handlers[spoof_handlers_index].whl_report_len;
     printf ("\n#spoof handler %s", spoof_handlers[spoof_handlers_index].pdv);
   }
   //
-  return ret;
+  return 0;
 }
 
 /*
@@ -854,7 +1254,7 @@ int get_int (char *buf, int off)
 
 unsigned short get_ushort (char *buf, int off)
 {
-  return (unsigned short)(buf[off+1]<<8|buf[off]);
+  return (unsigned short)((buf[off+1]&0xff)<<8|(buf[off]&0xff));
 }
 
 short get_short (unsigned char *buf, int off)
@@ -863,8 +1263,26 @@ short get_short (unsigned char *buf, int off)
 }
 
 //--PS2: Logitech Driving Force
-int whl_ps2_df_convert (char *rep, int rl)
+const s_remapEntry whl_ps2_df_remap[] = {
+  REMAP_ENTRY16 (G29_LB_IDX, G29_L1_MASK, offsetof(s_report_dfPs2, buttonsAndWheel), DF_L1_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_R1_MASK, offsetof(s_report_dfPs2, buttonsAndWheel), DF_R1_MASK),
+  REMAP_ENTRY16 (G29_PB_IDX, G29_SQUARE_MASK, offsetof(s_report_dfPs2, buttonsAndWheel), DF_SQUARE_MASK),
+  REMAP_ENTRY16 (G29_PB_IDX, G29_CROSS_MASK, offsetof(s_report_dfPs2, buttonsAndWheel), DF_CROSS_MASK),
+  REMAP_ENTRY16 (G29_PB_IDX, G29_CIRCLE_MASK, offsetof(s_report_dfPs2, buttonsAndWheel), DF_CIRCLE_MASK),
+  REMAP_ENTRY16 (G29_PB_IDX, G29_TRIANGLE_MASK, offsetof(s_report_dfPs2, buttonsAndWheel), DF_TRIANGLE_MASK),
+  { G29_HB_IDX, 0x0f, offsetof(s_report_dfPs2, hat), 0xff, 1 },
+  { G29_LB_IDX, G29_L2_MASK, offsetof(s_report_dfPs2, buttons), DF_L2_MASK, 0 },
+  { G29_LB_IDX, G29_R2_MASK, offsetof(s_report_dfPs2, buttons), DF_R2_MASK, 0 },
+  { G29_LB_IDX, G29_L3_MASK, offsetof(s_report_dfPs2, buttons), DF_L3_MASK, 0 },
+  { G29_LB_IDX, G29_R3_MASK, offsetof(s_report_dfPs2, buttons), DF_R3_MASK, 0 },
+  { G29_LB_IDX, G29_SHARE_MASK, offsetof(s_report_dfPs2, buttons), DF_SELECT_MASK, 0 },
+  { G29_LB_IDX, G29_OPTIONS_MASK, offsetof(s_report_dfPs2, buttons), DF_START_MASK, 0 },
+  { 0 },
+};
+
+int whl_ps2_df_convert (char *rep, int rl, char *out)
 {
+  s_report_dfPs2 * report = (s_report_dfPs2 *)out;
   /*
         pw_roll = normal_axis (get_short (report, 46), 0x0ffff); //from wheel turn
         lpacc   = normal_accel (get_short (report, 48), 0x0ffff);
@@ -872,9 +1290,9 @@ int whl_ps2_df_convert (char *rep, int rl)
   */
   //memcpy ((void *)&whl_report, (void *)&default_report, sizeof(s_report_dfPs2));
   //  wheel: 10B LSB
-  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_10BITS);
-  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
-  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long whl = axis_map (&whlAxes[AXIS_WHEEL], get_ushort (rep, 44), MAX_AXIS_VALUE_10BITS);
+  long acc = axis_map (&whlAxes[AXIS_GAS], get_ushort (rep, 46), MAX_AXIS_VALUE_8BITS);
+  long brk = axis_map (&whlAxes[AXIS_BRAKE], get_ushort (rep, 48), MAX_AXIS_VALUE_8BITS);
   #if 0
   long ped = get_cmap ((acc - brk) / 2 + CENTER_AXIS_VALUE_8BITS, 0, 255, 0, 255);
   printf("\nwhl %d [%02x %02x], acc %d, brk %d, ped %d", whl, whl>>8, whl&0xff, acc, brk, ped);
@@ -904,40 +1322,11 @@ int whl_ps2_df_convert (char *rep, int rl)
   report_gtf_out[5] = brk & 0xff;
   #endif
   //
-  whl_ps2_df_report.buttonsAndWheel = whl & 0xffff;
-  //
-  if (rep[G29_LB_IDX] & G29_L1_MASK)
-    whl_ps2_df_report.buttonsAndWheel |= DF_L1_MASK;
-  if (rep[G29_LB_IDX] & G29_R1_MASK)
-    whl_ps2_df_report.buttonsAndWheel |= DF_R1_MASK;
-  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
-    whl_ps2_df_report.buttonsAndWheel |= DF_SQUARE_MASK;
-  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
-    whl_ps2_df_report.buttonsAndWheel |= DF_CROSS_MASK;
-  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
-    whl_ps2_df_report.buttonsAndWheel |= DF_CIRCLE_MASK;
-  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
-    whl_ps2_df_report.buttonsAndWheel |= DF_TRIANGLE_MASK;
-  //hat
-  whl_ps2_df_report.hat = rep[G29_HB_IDX] & 0x0f;
-  //buttons
-  //whl_ps2_df_report.buttons = rep[G29_LB_IDX];
-  whl_ps2_df_report.buttons = 0x00;
-  if (rep[G29_LB_IDX] & G29_L2_MASK)
-    whl_ps2_df_report.buttons |= DF_L2_MASK;
-  if (rep[G29_LB_IDX] & G29_R2_MASK)
-    whl_ps2_df_report.buttons |= DF_R2_MASK;
-  if (rep[G29_LB_IDX] & G29_L3_MASK)
-    whl_ps2_df_report.buttons |= DF_L3_MASK;
-  if (rep[G29_LB_IDX] & G29_R3_MASK)
-    whl_ps2_df_report.buttons |= DF_R3_MASK;
-  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
-    whl_ps2_df_report.buttons |= DF_SELECT_MASK;
-  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
-    whl_ps2_df_report.buttons |= DF_START_MASK;
-  //whl_report.pedals = ped & 0xff;
-  whl_ps2_df_report.gasPedal = acc & 0xff;
-  whl_ps2_df_report.brakePedal = brk & 0xff;
+  report->buttonsAndWheel = whl & 0xffff;
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
+  //buttons and hat
+  remap_apply (&whlRemap, (const uint8_t *)rep, (uint8_t *)out);
   //
   return WHL_PS2_DF_REPORT_LEN;
 }
@@ -1066,8 +1455,26 @@ static s_report_dfpPs2 whl_ps2_dfp_report_default =
   .unknown2 = 0xff,
 };
 
-int whl_ps2_dfp_convert (char *rep, int rl)
+const s_remapEntry whl_ps2_dfp_remap[] = {
+  REMAP_ENTRY16 (G29_PB_IDX, G29_SQUARE_MASK, offsetof(s_report_dfpPs2, buttonsAndWheel), DFP_SQUARE_MASK),
+  REMAP_ENTRY16 (G29_PB_IDX, G29_CROSS_MASK, offsetof(s_report_dfpPs2, buttonsAndWheel), DFP_CROSS_MASK),
+  { G29_HB_IDX, 0x0f, offsetof(s_report_dfpPs2, hatAndButtons) + 1, 0xf0, 1 },
+  REMAP_ENTRY16 (G29_LB_IDX, G29_L1_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_L1_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_R1_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_R1_MASK),
+  REMAP_ENTRY16 (G29_PB_IDX, G29_CIRCLE_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_CIRCLE_MASK),
+  REMAP_ENTRY16 (G29_PB_IDX, G29_TRIANGLE_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_TRIANGLE_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_L2_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_L2_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_R2_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_R2_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_L3_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_L3_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_R3_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_R3_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_SHARE_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_SELECT_MASK),
+  REMAP_ENTRY16 (G29_LB_IDX, G29_OPTIONS_MASK, offsetof(s_report_dfpPs2, hatAndButtons), DFP_START_MASK),
+  { 0 },
+};
+
+int whl_ps2_dfp_convert (char *rep, int rl, char *out)
 {
+  s_report_dfpPs2 * report = (s_report_dfpPs2 *)out;
   if (0)
   {
     printf ("\n#whl in %d bytes: ", rl);
@@ -1075,48 +1482,23 @@ int whl_ps2_dfp_convert (char *rep, int rl)
       printf ("%02X ", rep[i]);
     fflush (stdout);
   }
-  memcpy ((void *)&whl_ps2_dfp_report, (void *)&whl_ps2_dfp_report_default, WHL_PS2_DFP_REPORT_LEN);
+  memcpy ((void *)report, (void *)&whl_ps2_dfp_report_default, WHL_PS2_DFP_REPORT_LEN);
   //
-  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_14BITS);
-  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
-  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long whl = axis_map (&whlAxes[AXIS_WHEEL], get_ushort (rep, 44), MAX_AXIS_VALUE_14BITS);
+  long acc = axis_map (&whlAxes[AXIS_GAS], get_ushort (rep, 46), MAX_AXIS_VALUE_8BITS);
+  long brk = axis_map (&whlAxes[AXIS_BRAKE], get_ushort (rep, 48), MAX_AXIS_VALUE_8BITS);
   //
-  whl_ps2_dfp_report.gasPedal = acc & 0xff;
-  whl_ps2_dfp_report.brakePedal = brk & 0xff;
-  whl_ps2_dfp_report.buttonsAndWheel = whl & 0xffff;
-  //
-  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
-    whl_ps2_dfp_report.buttonsAndWheel |= DFP_SQUARE_MASK;
-  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
-    whl_ps2_dfp_report.buttonsAndWheel |= DFP_CROSS_MASK;
-  //hat
-  whl_ps2_dfp_report.hatAndButtons = (rep[G29_HB_IDX] & 0x0f) << 12;
-  if (rep[G29_LB_IDX] & G29_L1_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_L1_MASK;
-  if (rep[G29_LB_IDX] & G29_R1_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_R1_MASK;
-  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_CIRCLE_MASK;
-  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_TRIANGLE_MASK;
-  if (rep[G29_LB_IDX] & G29_L2_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_L2_MASK;
-  if (rep[G29_LB_IDX] & G29_R2_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_R2_MASK;
-  if (rep[G29_LB_IDX] & G29_L3_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_L3_MASK;
-  if (rep[G29_LB_IDX] & G29_R3_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_R3_MASK;
-  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_SELECT_MASK;
-  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
-    whl_ps2_dfp_report.hatAndButtons |= DFP_START_MASK;
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
+  report->buttonsAndWheel = whl & 0xffff;
+  //buttons and hat
+  remap_apply (&whlRemap, (const uint8_t *)rep, (uint8_t *)out);
   //
   if (0)
   {
     printf ("\n#whl out %d bytes: ", WHL_PS2_DFP_REPORT_LEN);
     for (int i = 0; i < WHL_PS2_DFP_REPORT_LEN; i++)
-      printf ("%02X ", ((char *)&whl_ps2_dfp_report)[i]);
+      printf ("%02X ", out[i]);
     fflush (stdout);
   }
   return WHL_PS2_DFP_REPORT_LEN;
@@ -1349,8 +1731,33 @@ static s_report_dfgtPs3 whl_ps3_dfgt_report =
 };
 
 */
-int whl_ps3_dfgt_convert (char *rep, int rl)
+#define DFGT_SQUARE_MASK    0x20
+#define DFGT_CROSS_MASK     0x10
+#define DFGT_CIRCLE_MASK    0x40
+#define DFGT_TRIANGLE_MASK  0x80
+#define DFGT_PS_MASK        0x01
+
+const s_remapEntry whl_ps3_dfgt_remap[] = {
+  { G29_HB_IDX, 0x0f, offsetof(s_report_dfgtPs3, hatAndButtons), 0x0f, 1 },
+  { G29_PB_IDX, G29_SQUARE_MASK, offsetof(s_report_dfgtPs3, hatAndButtons), DFGT_SQUARE_MASK, 0 },
+  { G29_PB_IDX, G29_CROSS_MASK, offsetof(s_report_dfgtPs3, hatAndButtons), DFGT_CROSS_MASK, 0 },
+  { G29_PB_IDX, G29_CIRCLE_MASK, offsetof(s_report_dfgtPs3, hatAndButtons), DFGT_CIRCLE_MASK, 0 },
+  { G29_PB_IDX, G29_TRIANGLE_MASK, offsetof(s_report_dfgtPs3, hatAndButtons), DFGT_TRIANGLE_MASK, 0 },
+  { G29_LB_IDX, G29_L1_MASK, offsetof(s_report_dfgtPs3, buttons), G27_L1_MASK, 0 },
+  { G29_LB_IDX, G29_R1_MASK, offsetof(s_report_dfgtPs3, buttons), G27_R1_MASK, 0 },
+  { G29_LB_IDX, G29_L2_MASK, offsetof(s_report_dfgtPs3, buttons), G27_L2_MASK, 0 },
+  { G29_LB_IDX, G29_R2_MASK, offsetof(s_report_dfgtPs3, buttons), G27_R2_MASK, 0 },
+  { G29_LB_IDX, G29_L3_MASK, offsetof(s_report_dfgtPs3, buttons), G27_L3_MASK, 0 },
+  { G29_LB_IDX, G29_R3_MASK, offsetof(s_report_dfgtPs3, buttons), G27_R3_MASK, 0 },
+  { G29_LB_IDX, G29_SHARE_MASK, offsetof(s_report_dfgtPs3, buttons), G27_SELECT_MASK, 0 },
+  { G29_LB_IDX, G29_OPTIONS_MASK, offsetof(s_report_dfgtPs3, buttons), G27_START_MASK, 0 },
+  { G29_PS_IDX, G29_PS_MASK, offsetof(s_report_dfgtPs3, buttons3), DFGT_PS_MASK, 0 },
+  { 0 },
+};
+
+int whl_ps3_dfgt_convert (char *rep, int rl, char *out)
 {
+  s_report_dfgtPs3 * report = (s_report_dfgtPs3 *)out;
   if (0)
   {
     printf ("\n#whl in %d bytes: ", rl);
@@ -1359,59 +1766,20 @@ int whl_ps3_dfgt_convert (char *rep, int rl)
     fflush (stdout);
   }
   //wheel and pedals
-  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_14BITS);
-  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
-  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long whl = axis_map (&whlAxes[AXIS_WHEEL], get_ushort (rep, 44), MAX_AXIS_VALUE_14BITS);
+  long acc = axis_map (&whlAxes[AXIS_GAS], get_ushort (rep, 46), MAX_AXIS_VALUE_8BITS);
+  long brk = axis_map (&whlAxes[AXIS_BRAKE], get_ushort (rep, 48), MAX_AXIS_VALUE_8BITS);
+  report->wheel = (whl & 0xffff);//<<2;//((whl>>8) & 0xff) | ((whl & 0xff)<<8);
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
   //hat and buttons
-  whl_ps3_dfgt_report.hatAndButtons = rep[G29_HB_IDX] & 0x0f;
-  //
-  #define DFGT_SQUARE_MASK    0x20
-  #define DFGT_CROSS_MASK     0x10
-  #define DFGT_CIRCLE_MASK    0x40
-  #define DFGT_TRIANGLE_MASK  0x80
-  //
-  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
-    whl_ps3_dfgt_report.hatAndButtons |= DFGT_SQUARE_MASK;
-  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
-    whl_ps3_dfgt_report.hatAndButtons |= DFGT_CROSS_MASK;
-  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
-    whl_ps3_dfgt_report.hatAndButtons |= DFGT_CIRCLE_MASK;
-  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
-    whl_ps3_dfgt_report.hatAndButtons |= DFGT_TRIANGLE_MASK;
-  //buttons
-  whl_ps3_dfgt_report.buttons = 0x00;
-  if (rep[G29_LB_IDX] & G29_L1_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_L1_MASK;
-  if (rep[G29_LB_IDX] & G29_R1_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_R1_MASK;
-  if (rep[G29_LB_IDX] & G29_L2_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_L2_MASK;
-  if (rep[G29_LB_IDX] & G29_R2_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_R2_MASK;
-  if (rep[G29_LB_IDX] & G29_L3_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_L3_MASK;
-  if (rep[G29_LB_IDX] & G29_R3_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_R3_MASK;
-  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_SELECT_MASK;
-  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
-    whl_ps3_dfgt_report.buttons |= G27_START_MASK;
-  //
-  if (rep[G29_PS_IDX] & G29_PS_MASK)
-    whl_ps3_dfgt_report.buttons3 = 0x7f;
-  else
-    whl_ps3_dfgt_report.buttons3 = 0x7e;
-  //
-  whl_ps3_dfgt_report.wheel = (whl & 0xffff);//<<2;//((whl>>8) & 0xff) | ((whl & 0xff)<<8);
-  whl_ps3_dfgt_report.gasPedal = acc & 0xff;
-  whl_ps3_dfgt_report.brakePedal = brk & 0xff;
+  remap_apply (&whlRemap, (const uint8_t *)rep, (uint8_t *)out);
   //
   if (0)
   {
-    extern char *whl_report;
     printf ("\n#whl out %d bytes: ", WHL_PS3_DFGT_REPORT_LEN);
     for (int i = 0; i < WHL_PS3_DFGT_REPORT_LEN; i++)
-      printf ("%02X ", whl_report[i]);
+      printf ("%02X ", out[i]);
     fflush (stdout);
   }
   return WHL_PS3_DFGT_REPORT_LEN;
@@ -1458,8 +1826,28 @@ int ffb_ps3_dfgt_convert (unsigned char *ffbin, unsigned char *ffbot, int inlen)
 }
 
 //--PS3: Logitech G27
-int whl_ps3_g27_convert (char *rep, int rl)
+const s_remapEntry whl_ps3_g27_remap[] = {
+  { G29_HB_IDX, 0x0f, offsetof(s_report_g27Ps3, hatAndButtons), 0x0f, 1 },
+  { G29_PB_IDX, G29_SQUARE_MASK, offsetof(s_report_g27Ps3, hatAndButtons), DFGT_SQUARE_MASK, 0 },
+  { G29_PB_IDX, G29_CROSS_MASK, offsetof(s_report_g27Ps3, hatAndButtons), DFGT_CROSS_MASK, 0 },
+  { G29_PB_IDX, G29_CIRCLE_MASK, offsetof(s_report_g27Ps3, hatAndButtons), DFGT_CIRCLE_MASK, 0 },
+  { G29_PB_IDX, G29_TRIANGLE_MASK, offsetof(s_report_g27Ps3, hatAndButtons), DFGT_TRIANGLE_MASK, 0 },
+  { G29_LB_IDX, G29_L1_MASK, offsetof(s_report_g27Ps3, buttons), G27_L1_MASK, 0 },
+  { G29_LB_IDX, G29_R1_MASK, offsetof(s_report_g27Ps3, buttons), G27_R1_MASK, 0 },
+  { G29_LB_IDX, G29_L2_MASK, offsetof(s_report_g27Ps3, buttons), G27_L2_MASK, 0 },
+  { G29_LB_IDX, G29_R2_MASK, offsetof(s_report_g27Ps3, buttons), G27_R2_MASK, 0 },
+  { G29_LB_IDX, G29_L3_MASK, offsetof(s_report_g27Ps3, buttons), G27_L3_MASK, 0 },
+  { G29_LB_IDX, G29_R3_MASK, offsetof(s_report_g27Ps3, buttons), G27_R3_MASK, 0 },
+  { G29_LB_IDX, G29_SHARE_MASK, offsetof(s_report_g27Ps3, buttons), G27_SELECT_MASK, 0 },
+  { G29_LB_IDX, G29_OPTIONS_MASK, offsetof(s_report_g27Ps3, buttons), G27_START_MASK, 0 },
+  REMAP_ENTRY16 (G29_LB_IDX, G29_OPTIONS_MASK, offsetof(s_report_g27Ps3, buttonsAndWheel), G27_L5_MASK), // for NFS Shift 2
+  REMAP_ENTRY16 (G29_LB_IDX, G29_SHARE_MASK, offsetof(s_report_g27Ps3, buttonsAndWheel), G27_L4_MASK),
+  { 0 },
+};
+
+int whl_ps3_g27_convert (char *rep, int rl, char *out)
 {
+  s_report_g27Ps3 * report = (s_report_g27Ps3 *)out;
   if (0)
   {
     printf ("\n#whl in %d bytes: ", rl);
@@ -1468,61 +1856,20 @@ int whl_ps3_g27_convert (char *rep, int rl)
     fflush (stdout);
   }
   //wheel and pedals
-  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_14BITS);
-  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
-  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long whl = axis_map (&whlAxes[AXIS_WHEEL], get_ushort (rep, 44), MAX_AXIS_VALUE_14BITS);
+  long acc = axis_map (&whlAxes[AXIS_GAS], get_ushort (rep, 46), MAX_AXIS_VALUE_8BITS);
+  long brk = axis_map (&whlAxes[AXIS_BRAKE], get_ushort (rep, 48), MAX_AXIS_VALUE_8BITS);
+  report->buttonsAndWheel = (whl & 0xffff)<<2;//((whl>>8) & 0xff) | ((whl & 0xff)<<8);
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
   //hat and buttons
-  whl_ps3_g27_report.hatAndButtons = rep[G29_HB_IDX] & 0x0f;
-  //
-  #define DFGT_SQUARE_MASK    0x20
-  #define DFGT_CROSS_MASK     0x10
-  #define DFGT_CIRCLE_MASK    0x40
-  #define DFGT_TRIANGLE_MASK  0x80
-  //
-  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
-    whl_ps3_g27_report.hatAndButtons |= DFGT_SQUARE_MASK;
-  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
-    whl_ps3_g27_report.hatAndButtons |= DFGT_CROSS_MASK;
-  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
-    whl_ps3_g27_report.hatAndButtons |= DFGT_CIRCLE_MASK;
-  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
-    whl_ps3_g27_report.hatAndButtons |= DFGT_TRIANGLE_MASK;
-  //buttons
-  whl_ps3_g27_report.buttons = 0x00;
-  if (rep[G29_LB_IDX] & G29_L1_MASK)
-    whl_ps3_g27_report.buttons |= G27_L1_MASK;
-  if (rep[G29_LB_IDX] & G29_R1_MASK)
-    whl_ps3_g27_report.buttons |= G27_R1_MASK;
-  if (rep[G29_LB_IDX] & G29_L2_MASK)
-    whl_ps3_g27_report.buttons |= G27_L2_MASK;
-  if (rep[G29_LB_IDX] & G29_R2_MASK)
-    whl_ps3_g27_report.buttons |= G27_R2_MASK;
-  if (rep[G29_LB_IDX] & G29_L3_MASK)
-    whl_ps3_g27_report.buttons |= G27_L3_MASK;
-  if (rep[G29_LB_IDX] & G29_R3_MASK)
-    whl_ps3_g27_report.buttons |= G27_R3_MASK;
-  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
-    whl_ps3_g27_report.buttons |= G27_SELECT_MASK;
-  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
-    whl_ps3_g27_report.buttons |= G27_START_MASK;
-  //
-  //whl_ps3_dfgt_report.psButton = rep[G29_PS_IDX];
-  //
-  whl_ps3_g27_report.buttonsAndWheel = (whl & 0xffff)<<2;//((whl>>8) & 0xff) | ((whl & 0xff)<<8);
-  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK) // for NFS Shift 2
-    whl_ps3_g27_report.buttonsAndWheel |= G27_L5_MASK;
-  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
-    whl_ps3_g27_report.buttonsAndWheel |= G27_L4_MASK;
-  //
-  whl_ps3_g27_report.gasPedal = acc & 0xff;
-  whl_ps3_g27_report.brakePedal = brk & 0xff;
+  remap_apply (&whlRemap, (const uint8_t *)rep, (uint8_t *)out);
   //
   if (0)
   {
-    extern char *whl_report;
     printf ("\n#whl in %d bytes: ", WHL_PS3_G27_REPORT_LEN);
     for (int i = 0; i < WHL_PS3_G27_REPORT_LEN; i++)
-      printf ("%02X ", whl_report[i]);
+      printf ("%02X ", out[i]);
     fflush (stdout);
   }  //
   return WHL_PS3_G27_REPORT_LEN;
@@ -1568,127 +1915,446 @@ int ffb_ps3_g27_convert (unsigned char *ffbin, unsigned char *ffbot, int inlen)
 //--end spoof
 //*****************************************************************************
 
-// send report from wheel to emulator
-static int send_next_in_packet()
+static unsigned int elapsed_ms ()
 {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec - startTime.tv_sec) * 1000 + (ts.tv_nsec - startTime.tv_nsec) / 1000000;
+}
 
-  if (inPending)
-  {
-    return 0;
-  }
+static double elapsed_us ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec - startTime.tv_sec) * 1000000.0 + (ts.tv_nsec - startTime.tv_nsec) / 1000.0;
+}
 
-  if (nbInEpFifo > 0)
+/*
+ * Get the pending mailbox that was filled first, or -1 if none.
+ */
+static int next_in_mailbox()
+{
+  int next = -1;
+  unsigned int i;
+  for (i = 0; i < sizeof(inPackets) / sizeof(*inPackets); ++i)
   {
-    uint8_t inPacketIndex = ENDPOINT_ADDR_TO_INDEX(inEpFifo[0]);
-    int ret = 0;
-    if (spoof_device_index != -1)
+    if (inPackets[i].pending && (next < 0 || inPackets[i].filled < inPackets[next].filled))
     {
-      char *buf = (char *)&inPackets[inPacketIndex].packet;
-      int bsz = inPackets[inPacketIndex].length;
-      ret = adapter_send(adapter, E_TYPE_IN, (const unsigned char *)spoof_handlers[spoof_handlers_index].whl_report, spoof_handlers[spoof_handlers_index].whl (buf, bsz));
+      next = i;
     }
-    else
-      ret = adapter_send(adapter, E_TYPE_IN, (const void *)&inPackets[inPacketIndex].packet, inPackets[inPacketIndex].length);
-    if(ret < 0)
+  }
+  return next;
+}
+
+/*
+ * Decode the last report of each input over the wheel state.
+ *
+ * \return the merged state, in the G29 layout
+ */
+static char * merge_inputs(const char * rep, int rl)
+{
+  if (rep != (const char *)&decodedPacket)
+  {
+    memcpy (&decodedPacket, rep, rl < (int)sizeof(decodedPacket) ? rl : (int)sizeof(decodedPacket));
+  }
+  unsigned int i;
+  for (i = 0; i < nbInputs; ++i)
+  {
+    if (inputs[i].length)
     {
-      return -1;
+      hidplan_apply (&inputs[i].plan, inputs[i].report, inputs[i].length, (uint8_t *)&decodedPacket);
     }
-    inPending = inEpFifo[0];
-    //printf ("\n#send_next_in_packet %d inPending", inPending);
-    //fflush (stdout);
-    --nbInEpFifo;
-    memmove(inEpFifo, inEpFifo + 1, nbInEpFifo * sizeof(*inEpFifo));
   }
-
-  return 0;
+  return (char *)&decodedPacket;
 }
 
-static int queue_in_packet(unsigned char endpoint, const void * buf, int transfered)
+/*
+ * Get the wheel state the converters read from a mailbox report: decoded with --decode,
+ * and merged with the inputs.
+ */
+static char * wheel_state(char * rep, int * rl)
 {
+  if (decode)
+  {
+    // a report without the fields of the plan leaves the last decoded state
+    hidplan_apply (&whlPlan, (const uint8_t *)rep + 1, *rl - 1, (uint8_t *)&decodedPacket);
+    rep = (char *)&decodedPacket;
+    *rl = sizeof(decodedPacket);
+  }
+  if (nbInputs)
+  {
+    rep = merge_inputs (rep, *rl);
+  }
+  return rep;
+}
 
-  if (nbInEpFifo == sizeof(inEpFifo) / sizeof(*inEpFifo))
+/*
+ * Send the last converted report of a mirror, if its adapter has a credit.
+ */
+static int mirror_flush(unsigned int i)
+{
+  if (!mirrors[i].pending || !mirrors[i].credits)
+  {
+    return 0;
+  }
+  if (adapter_send_frame (mirrors[i].adapter, &mirrors[i].frame) < 0)
   {
-    PRINT_ERROR_OTHER("no more space in inEpFifo")
     return -1;
   }
-  //printf("\n#queue_in_packet ep %02X vs %02X idx %02X", endpoint, U2S_ENDPOINT(endpoint), ENDPOINT_ADDR_TO_INDEX(endpoint));
-  uint8_t inPacketIndex = ENDPOINT_ADDR_TO_INDEX(endpoint);
-  inPackets[inPacketIndex].packet.endpoint = U2S_ENDPOINT(endpoint);
-  memcpy(inPackets[inPacketIndex].packet.data, buf, transfered);
-  inPackets[inPacketIndex].length = transfered + 1;
-  inEpFifo[nbInEpFifo] = endpoint;
-  ++nbInEpFifo;
-
-  /*
-   * TODO MLA: Poll the endpoint after registering the packet?
-   */
-
+  mirrors[i].pending = 0;
+  --mirrors[i].credits;
+  ++mirrors[i].sent;
   return 0;
 }
 
-int usb_read_callback(int user, unsigned char endpoint, const void * buf, int status)
+/*
+ * Convert the last wheel state for each mirror, as soon as a wheel or input report arrives:
+ * the mirrors don't wait for the credits or the polls of the primary adapter.
+ */
+static int mirror_reports()
 {
-  switch (status)
+  if (!nbMirrors || lastWheelIndex < 0)
   {
-  case E_TRANSFER_TIMED_OUT:
-    PRINT_TRANSFER_READ_ERROR (endpoint, "TIMEOUT")
-    break;
-  case E_TRANSFER_STALL:
-    break;
-  case E_TRANSFER_ERROR:
-    PRINT_TRANSFER_WRITE_ERROR (endpoint, "OTHER ERROR")
-    return -1;
-  default:
-    break;
+    return 0;
   }
-
-  if (endpoint == 0)
+  char * rep = (char *)&inPackets[lastWheelIndex].frame.packet;
+  int rl = inPackets[lastWheelIndex].frame.header.length;
+  rep = wheel_state (rep, &rl);
+  unsigned int i;
+  for (i = 0; i < nbMirrors; ++i)
   {
-    if (status > (int)MAX_PACKET_VALUE_SIZE)
-    {
-      PRINT_ERROR_OTHER ("too many bytes transfered")
-      done = 1;
-      return -1;
-    }
-
-    int ret;
-    if (status >= 0)
+    if (!mirrors[i].ready)
     {
-      ret = adapter_send (adapter, E_TYPE_CONTROL, buf, status);
+      continue;
     }
-    else
+    if (mirrors[i].pending)
     {
-      ret = adapter_send (adapter, E_TYPE_CONTROL_STALL, NULL, 0);
+      ++mirrors[i].coalesced;
     }
-    if(ret < 0)
+    mirrors[i].frame.header.length = mirrors[i].convert (rep, rl, (char *)mirrors[i].frame.value);
+    mirrors[i].pending = 1;
+    if (mirror_flush (i) < 0)
     {
       return -1;
     }
   }
-  else
+  return 0;
+}
+
+// send report from wheel to emulator
+static int send_next_in_packet()
+{
+  int inPacketIndex;
+
+  while (inCredits > 0 && (inPacketIndex = next_in_mailbox ()) >= 0)
   {
-    if (status > MAX_PAYLOAD_SIZE_EP)
+    unsigned char * data = inPackets[inPacketIndex].frame.packet.data;
+    unsigned char actual[MAX_PAYLOAD_SIZE_EP];
+    uint8_t relatch = 0; // the sent report has latched bits the last one doesn't have
+    unsigned int latchLength = inPackets[inPacketIndex].frame.header.length - 1u;
+    if (latchLength > latchMaskLength)
     {
-      PRINT_ERROR_OTHER ("too many bytes transfered")
-      done = 1;
-      return -1;
+      latchLength = latchMaskLength;
     }
-
-    if (status >= 0)
+    unsigned int i;
+    for (i = 0; i < latchLength; ++i)
     {
-      int ret = queue_in_packet (endpoint, buf, status);
-      if (ret < 0)
+      actual[i] = data[i];
+      relatch |= inPackets[inPacketIndex].latched[i] & ~data[i];
+      data[i] |= inPackets[inPacketIndex].latched[i];
+    }
+    memset (inPackets[inPacketIndex].latched, 0x00, sizeof(inPackets->latched));
+    const s_packet * frame = (const s_packet *)&inPackets[inPacketIndex].frame;
+    if (whlConvert != NULL)
+    {
+      char * rep = (char *)&inPackets[inPacketIndex].frame.packet;
+      int rl = inPackets[inPacketIndex].frame.header.length;
+      rep = wheel_state (rep, &rl);
+      spoofFrame.header.length = whlConvert (rep, rl, (char *)spoofFrame.value);
+      frame = &spoofFrame;
+      for (i = 0; skewHist.binUs && i < nbInputs; ++i)
+      {
+        if (inputs[i].length)
+        {
+          double skew = lastWheelTime - inputs[i].time;
+          stats_hist_add (&skewHist, skew < 0 ? -skew : skew);
+        }
+      }
+    }
+    const unsigned char * report = frame->value;
+    int length = frame->header.length;
+    if (cachedIn && length == lastInReports[inPacketIndex].length && !memcmp (report, lastInReports[inPacketIndex].data, length))
+    {
+      // the adapter already answers the polls with this report
+      ++inStats.unchanged;
+    }
+    else
+    {
+      if (adapter_send_frame (adapter, frame) < 0)
       {
-        done = 1;
         return -1;
       }
+      if (cachedIn && length <= (int)sizeof(lastInReports->data))
+      {
+        memcpy (lastInReports[inPacketIndex].data, report, length);
+        lastInReports[inPacketIndex].length = length;
+      }
+      inFlight[inFlightTail++] = inPackets[inPacketIndex].time;
+      lastInLength = length;
+      ++inStats.sent;
+      --inCredits;
+    }
+    memcpy (data, actual, latchLength);
+    // the released bits go in the next send
+    inPackets[inPacketIndex].pending = relatch ? 1 : 0;
+    inPackets[inPacketIndex].filled = elapsed_us ();
+  }
 
-      ret = send_next_in_packet ();
+  return 0;
+}
+
+/*
+ * Put a wheel report into the mailbox of its endpoint.
+ */
+static void queue_in_packet(unsigned char endpoint, const void * buf, int transfered)
+{
+  uint8_t inPacketIndex = ENDPOINT_ADDR_TO_INDEX(endpoint);
+  double now = elapsed_us ();
+  if (inPackets[inPacketIndex].pending)
+  {
+    unsigned int i;
+    for (i = 0; i < latchMaskLength && i < inPackets[inPacketIndex].frame.header.length - 1u; ++i)
+    {
+      inPackets[inPacketIndex].latched[i] |= inPackets[inPacketIndex].frame.packet.data[i] & latchMask[i];
+    }
+    ++inStats.coalesced;
+  }
+  else
+  {
+    inPackets[inPacketIndex].filled = now;
+    inPackets[inPacketIndex].pending = 1;
+  }
+  // the wheel buffer is reused by the next poll
+  inPackets[inPacketIndex].frame.header.type = E_TYPE_IN;
+  inPackets[inPacketIndex].frame.header.length = transfered + 1;
+  inPackets[inPacketIndex].frame.packet.endpoint = U2S_ENDPOINT(endpoint);
+  memcpy(inPackets[inPacketIndex].frame.packet.data, buf, transfered);
+  inPackets[inPacketIndex].time = now;
+  lastWheelIndex = inPacketIndex;
+  lastWheelTime = now;
+}
+
+/*
+ * Make the last wheel report pending again, to be merged with the newer report of an input.
+ */
+static void requeue_in_packet(double time)
+{
+  if (lastWheelIndex < 0)
+  {
+    return;
+  }
+  if (!inPackets[lastWheelIndex].pending)
+  {
+    inPackets[lastWheelIndex].filled = time;
+    inPackets[lastWheelIndex].pending = 1;
+  }
+  inPackets[lastWheelIndex].time = time;
+}
+
+static int ctl_cacheable (const struct usb_ctrlrequest * setup)
+{
+  if (setup->bRequestType == (USB_DIR_IN | USB_TYPE_STANDARD | USB_RECIP_DEVICE)
+      || setup->bRequestType == (USB_DIR_IN | USB_TYPE_STANDARD | USB_RECIP_INTERFACE))
+  {
+    return setup->bRequest == USB_REQ_GET_DESCRIPTOR;
+  }
+  if (setup->bRequestType == (USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE))
+  {
+    return setup->bRequest == HID_REQ_GET_REPORT && FEATURE_IS_SET (cachedReports, setup->wValue & 0xff);
+  }
+  return 0;
+}
+
+static void ctl_cache_invalidate ()
+{
+  unsigned int i;
+  for (i = 0; i < CTL_CACHE_SIZE; ++i)
+  {
+    if (ctlCache[i].length)
+    {
+      ctlCache[i].length = 0;
+      ++ctlStats.invalidations;
+    }
+  }
+}
+
+static int ctl_cache_lookup (const struct usb_ctrlrequest * setup)
+{
+  unsigned int i;
+  for (i = 0; i < CTL_CACHE_SIZE; ++i)
+  {
+    if (ctlCache[i].length && !memcmp (&ctlCache[i].setup, setup, sizeof(*setup)))
+    {
+      if (elapsed_ms () - ctlCache[i].time < ctlTtl)
+      {
+        return i;
+      }
+      ctlCache[i].length = 0; // expired
+    }
+  }
+  return -1;
+}
+
+static void ctl_cache_store (const struct usb_ctrlrequest * setup, const void * buf, int status)
+{
+  if (status <= 0 || status > (int)sizeof(ctlCache->data))
+  {
+    return;
+  }
+  // take a free entry, or the oldest one
+  unsigned int i, entry = 0;
+  for (i = 0; i < CTL_CACHE_SIZE; ++i)
+  {
+    if (!ctlCache[i].length)
+    {
+      entry = i;
+      break;
+    }
+    if (ctlCache[i].time < ctlCache[entry].time)
+    {
+      entry = i;
+    }
+  }
+  ctlCache[entry].setup = *setup;
+  ctlCache[entry].time = elapsed_ms ();
+  ctlCache[entry].length = status;
+  memcpy (ctlCache[entry].data, buf, status);
+}
+
+static int learn_feature (const void * buf, int status)
+{
+  if (pendingSetup.bRequestType != (USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE)
+      || pendingSetup.bRequest != HID_REQ_GET_REPORT
+      || (pendingSetup.wValue >> 8) != HID_REPORT_TYPE_FEATURE)
+  {
+    return 0;
+  }
+  uint8_t reportId = pendingSetup.wValue & 0xff;
+  if (!FEATURE_IS_SET (staticFeatures, reportId) || FEATURE_IS_SET (learnedFeatures, reportId))
+  {
+    return 0;
+  }
+  FEATURE_SET (learnedFeatures, reportId);
+  unsigned char feature[MAX_FEATURES_SIZE];
+  s_featureHeader * header = (s_featureHeader *)feature;
+  if (featuresSize + sizeof(*header) + status > sizeof(feature))
+  {
+    fprintf (stderr, "\n#e:feature report 0x%02x does not fit into the adapter (%d bytes)", reportId, status);
+    return 0;
+  }
+  header->reportId = reportId;
+  header->interface = pendingSetup.wIndex;
+  header->length = status;
+  memcpy (header + 1, buf, status);
+  featuresSize += sizeof(*header) + status;
+  printf ("\n#i:feature report 0x%02x (%d bytes) is now answered by the adapter", reportId, status);
+  return adapter_send (adapter, E_TYPE_FEATURES, feature, sizeof(*header) + status);
+}
+
+/*
+ * The transfers to the wheel, either the real one or the fake one.
+ */
+static int wheel_poll (unsigned char endpoint)
+{
+  return fakeWheel ? fakewheel_poll (endpoint) : gusb_poll (usb, endpoint);
+}
+
+static int wheel_write (unsigned char endpoint, const void * buf, unsigned int count)
+{
+  return fakeWheel ? fakewheel_write (endpoint, buf, count) : gusb_write (usb, endpoint, buf, count);
+}
+
+int usb_read_callback(int user, unsigned char endpoint, const void * buf, int status)
+{
+  switch (status)
+  {
+  case E_TRANSFER_TIMED_OUT:
+    PRINT_TRANSFER_READ_ERROR (endpoint, "TIMEOUT")
+    break;
+  case E_TRANSFER_STALL:
+    break;
+  case E_TRANSFER_ERROR:
+    PRINT_TRANSFER_WRITE_ERROR (endpoint, "OTHER ERROR")
+    return -1;
+  default:
+    break;
+  }
+
+  if (endpoint == 0)
+  {
+    if (status > (int)MAX_PACKET_VALUE_SIZE)
+    {
+      PRINT_ERROR_OTHER ("too many bytes transfered")
+      done = 1;
+      return -1;
+    }
+
+    int ret;
+    if (status >= 0)
+    {
+      ret = adapter_send (adapter, E_TYPE_CONTROL, buf, status);
+      if (ctlTtl && ctl_cacheable (&pendingSetup))
+      {
+        ctl_cache_store (&pendingSetup, buf, status);
+      }
+      if (ret >= 0 && localHid)
+      {
+        ret = learn_feature (buf, status);
+      }
+    }
+    else
+    {
+      ret = adapter_send (adapter, E_TYPE_CONTROL_STALL, NULL, 0);
+    }
+    if(ret < 0)
+    {
+      return -1;
+    }
+  }
+  else
+  {
+    if (status > MAX_PAYLOAD_SIZE_EP)
+    {
+      PRINT_ERROR_OTHER ("too many bytes transfered")
+      done = 1;
+      return -1;
+    }
+
+    if (status >= 0)
+    {
+      queue_in_packet (endpoint, buf, status);
+
+      // the mailbox keeps the freshest report: poll the wheel again right away
+      int ret = wheel_poll (endpoint);
+      if (ret >= 0)
+      {
+        ret = mirror_reports ();
+      }
       if (ret < 0)
       {
         done = 1;
         return -1;
       }
+
+      if (!jit_locked ())
+      {
+        ret = send_next_in_packet ();
+        if (ret < 0)
+        {
+          done = 1;
+          return -1;
+        }
+      }
     }
   }
 
@@ -1997,6 +2663,7 @@ void fix_endpoints()
           pEndpoints->number = endpoint->bEndpointAddress;
           pEndpoints->type = endpoint->bmAttributes & USB_ENDPOINT_XFERTYPE_MASK;
           pEndpoints->size = endpoint->wMaxPacketSize;
+          pEndpoints->flags = 0;
           ++pEndpoints;
         }
       }
@@ -2025,7 +2692,17 @@ static int add_descriptor(uint16_t wValue, uint16_t wIndex, uint16_t wLength, vo
   return 0;
 }
 
-int send_descriptors() 
+static int send_config (unsigned char type, const unsigned char * data, unsigned int count)
+{
+  unsigned int i;
+  for (i = 0; i < count; ++i)
+  {
+    configChecksum = config_checksum (configChecksum, data[i]);
+  }
+  return adapter_send (adapter, type, data, count);
+}
+
+static int prepare_descriptors()
 {
 
   int ret;
@@ -2063,45 +2740,155 @@ int send_descriptors()
     }
   }
 
-  if (spoof_device_index == -1)
-    ret = adapter_send (adapter, E_TYPE_DESCRIPTORS, desc, pDesc - desc);
-  else
+  // the spoofed descriptors are sent instead of these ones
+  unsigned int stored = (pDesc - desc) + (pDescIndex - descIndex) * sizeof(*descIndex);
+  if (spoofFrames != NULL)
   {
-    printf ("\n#skip sending descriptors");
-    ret = 0;
+    stored = 0;
+    const SPOOF_PKT * frame;
+    for (frame = spoofFrames; frame->type != E_TYPE_RESET; ++frame)
+    {
+      if (frame->type == E_TYPE_DESCRIPTORS || frame->type == E_TYPE_INDEX)
+      {
+        stored += frame->len;
+      }
+    }
   }
-  if (ret < 0)
+  if (stored > MAX_STORED_CONFIG_SIZE)
   {
+    PRINT_ERROR_OTHER ("the descriptors don't fit into the adapter EEPROM")
     return -1;
   }
 
   return 0;
 }
 
-static int send_index ()
+static uint32_t hash_bytes (uint32_t hash, const unsigned char * data, unsigned int count)
+{
+  unsigned int i;
+  for (i = 0; i < count; ++i)
+  {
+    hash = config_hash (hash, data[i]);
+  }
+  return hash;
+}
+
+/*
+ * Hash of the descriptors and index frames of a spoofed device, in the order they are sent.
+ */
+static uint32_t config_hash_frames (const SPOOF_PKT * frames)
+{
+  uint32_t hash = CONFIG_HASH_INIT;
+  const SPOOF_PKT * frame;
+  for (frame = frames; frame->type != E_TYPE_RESET; ++frame)
+  {
+    if (frame->type == E_TYPE_DESCRIPTORS || frame->type == E_TYPE_INDEX)
+    {
+      hash = hash_bytes (hash, frame->pkt, frame->len);
+    }
+  }
+  return hash;
+}
+
+/*
+ * Hash of the descriptors and index frames, in the order they are sent.
+ */
+static uint32_t config_hash_descriptors ()
 {
+  uint32_t hash = CONFIG_HASH_INIT;
 
-  if (descIndexSent)
+  if (spoofFrames == NULL)
   {
-    return 0;
+    hash = hash_bytes (hash, desc, pDesc - desc);
+    hash = hash_bytes (hash, (unsigned char *)&descIndex, (pDescIndex - descIndex) * sizeof(*descIndex));
+  }
+  else
+  {
+    hash = config_hash_frames (spoofFrames);
   }
 
-  descIndexSent = 1;
+  return hash;
+}
 
-  return adapter_send (adapter, E_TYPE_INDEX, (unsigned char *)&descIndex, (pDescIndex - descIndex) * sizeof(*descIndex));
+static void set_endpoint_flags(s_endpointConfig * table, unsigned int count)
+{
+  unsigned int i;
+  for (i = 0; i < count && table[i].number; ++i)
+  {
+    table[i].flags = 0;
+    if (cachedIn && (table[i].number & USB_ENDPOINT_DIR_MASK) == USB_DIR_IN)
+    {
+      table[i].flags |= EP_FLAG_CACHED;
+    }
+    if (!singleBank)
+    {
+      table[i].flags |= EP_FLAG_DOUBLE_BANK;
+    }
+  }
 }
 
 static int send_endpoints() 
 {
 
-  if (endpointsSent)
+  set_endpoint_flags (endpoints, pEndpoints - endpoints);
+
+  return send_config (E_TYPE_ENDPOINTS, (unsigned char *)&endpoints, (pEndpoints - endpoints) * sizeof(*endpoints));
+}
+
+/*
+ * Stream the configuration, the adapter acks once with a checksum.
+ * The descriptors and index are skipped if the adapter already stores them.
+ */
+static int send_configuration (int upload)
+{
+  if (spoofFrames == NULL)
   {
-    return 0;
+    if (upload)
+    {
+      if (send_config (E_TYPE_DESCRIPTORS, desc, pDesc - desc) < 0
+          || send_config (E_TYPE_INDEX, (unsigned char *)&descIndex, (pDescIndex - descIndex) * sizeof(*descIndex)) < 0)
+      {
+        return -1;
+      }
+    }
+    if (send_endpoints () < 0)
+    {
+      return -1;
+    }
+  }
+  else
+  {
+    //send spoof device
+    SPOOF_PKT * frame;
+    for (frame = spoofFrames; frame->type != E_TYPE_RESET; ++frame)
+    {
+      if (!upload && (frame->type == E_TYPE_DESCRIPTORS || frame->type == E_TYPE_INDEX))
+      {
+        continue;
+      }
+      printf("\n#spoof dev data %d type %02X", (int)(frame - spoofFrames), frame->type);
+      if (frame->type == E_TYPE_ENDPOINTS)
+      {
+        set_endpoint_flags ((s_endpointConfig *)frame->pkt, frame->len / sizeof(s_endpointConfig));
+      }
+      if (send_config (frame->type, frame->pkt, frame->len) < 0)
+      {
+        printf("\n#!ERR:spoof dev data %d type %02X", (int)(frame - spoofFrames), frame->type);
+        return -1;
+      }
+    }
   }
 
-  endpointsSent = 1;
+  if (localHid)
+  {
+    // an empty feature frame enables the local answers
+    if (adapter_send (adapter, E_TYPE_FEATURES, NULL, 0) < 0)
+    {
+      return -1;
+    }
+  }
 
-  return adapter_send (adapter, E_TYPE_ENDPOINTS, (unsigned char *)&endpoints, (pEndpoints - endpoints) * sizeof(*endpoints));
+  return 0;
 }
 
 static int poll_all_endpoints ()
@@ -2114,10 +2901,14 @@ static int poll_all_endpoints ()
     uint8_t endpoint = S2U_ENDPOINT (USB_DIR_IN | i);
     if (endpoint)
     {
-      ret = gusb_poll (usb, endpoint);
+      ret = wheel_poll (endpoint);
       //printf ("\n#polling EP %d vs %d ret %d", endpoint, i, ret);
     }
   }
+  for (i = 0; i < nbInputs && ret >= 0; ++i)
+  {
+    ret = gusb_poll (inputs[i].usb, inputs[i].endpoint);
+  }
   return ret;
 }
 
@@ -2154,7 +2945,7 @@ static int send_out_packet(s_packet * packet)
     fflush (stdout);
   }
   //
-  if (spoof_device_index != -1)
+  if (spoofFrames != NULL && spoof_handlers_index != -1 && spoof_handlers[spoof_handlers_index].ffb != NULL)
   {
     
     unsigned char *buf = (unsigned char *)epPacket->data;
@@ -2179,7 +2970,7 @@ static int send_out_packet(s_packet * packet)
       return 0;
     //return gusb_write (usb, S2U_ENDPOINT(epPacket->endpoint), buf, bsz);
     //return gusb_write (usb, 0x03, buf, bsz);
-    int ret = gusb_write (usb, S2U_ENDPOINT(epPacket->endpoint), buf, bsz);
+    int ret = wheel_write (S2U_ENDPOINT(epPacket->endpoint), buf, bsz);
     if (0)
     {
       printf ("\n#ffb %d bytes for ep %02X: ", bsz, S2U_ENDPOINT(epPacket->endpoint));
@@ -2190,7 +2981,7 @@ static int send_out_packet(s_packet * packet)
     }
     return ret;
   }
-  int ret = gusb_write (usb, S2U_ENDPOINT(epPacket->endpoint), epPacket->data, packet->header.length - 1);
+  int ret = wheel_write (S2U_ENDPOINT(epPacket->endpoint), epPacket->data, packet->header.length - 1);
   if (0)
   {
     int  bsz = packet->header.length - 1;
@@ -2209,6 +3000,25 @@ static int send_control_packet(s_packet * packet)
 {
 
   struct usb_ctrlrequest * setup = (struct usb_ctrlrequest *)packet->value;
+  pendingSetup = *setup;
+
+  if (ctlTtl)
+  {
+    if (!(setup->bRequestType & USB_DIR_IN))
+    {
+      ctl_cache_invalidate ();
+    }
+    else if (ctl_cacheable (setup))
+    {
+      int entry = ctl_cache_lookup (setup);
+      if (entry >= 0)
+      {
+        ++ctlStats.hits;
+        return adapter_send (adapter, E_TYPE_CONTROL, ctlCache[entry].data, ctlCache[entry].length);
+      }
+      ++ctlStats.misses;
+    }
+  }
   if ((setup->bRequestType & USB_RECIP_MASK) == USB_RECIP_ENDPOINT) 
   {
     if (setup->wIndex != 0) {
@@ -2224,72 +3034,348 @@ static int send_control_packet(s_packet * packet)
       printf ("%02X ", buf[i]);
     fflush (stdout);
   }
-  return gusb_write (usb, 0, packet->value, packet->header.length);
+  return wheel_write (0, packet->value, packet->header.length);
 }
 
-static void dump(unsigned char * data, unsigned char length)
+/*
+ * Print the adapter counters, with the counts since the previous frame.
+ */
+static void print_counters(const s_counters * counters, const s_counters * previous)
 {
-  int i;
-  for (i = 0; i < length; ++i)
+  static unsigned int coalesced = 0;
+#define DELTA(FIELD) (counters->FIELD - previous->FIELD)
+  printf ("\n#s:fw loops %u (max %u us) isr max %.1f us"
+      " | IN %u sent %u cached %u NAK %u coalesced | OUT %u sent %u NAK"
+      " | ctl %u relayed %u timeout %u local | rx overruns %u",
+      DELTA(loops), counters->maxLoopTime * 16, counters->maxIsrTime / 2.0,
+      DELTA(inPackets), DELTA(cachedPolls), DELTA(inNaks), inStats.coalesced - coalesced, DELTA(outPackets), DELTA(outNaks),
+      DELTA(controlRelayed), DELTA(controlTimeouts), DELTA(localControls), DELTA(rxOverruns));
+#undef DELTA
+  if (polls.period > 0)
   {
-    if(i && !(i % 8))
-    {
-      printf("\n");
-    }
-    printf("0x%02x ", data[i]);
+    printf (" | poll %.0f us", polls.period);
   }
-  printf("\n");
+  coalesced = inStats.coalesced;
+  fflush (stdout);
 }
 
-static int process_packet(int user, s_packet * packet)
+/*
+ * Arm the jit timer for the first predicted poll far enough in the future.
+ */
+static int jit_schedule()
+{
+  if (polls.period <= 0)
+  {
+    return 0;
+  }
+
+  double guard = clockSync.avgRtt / 2 + (lastInLength + sizeof(s_header)) * 10 * 1000000.0 / USART_BAUDRATE + JIT_MARGIN;
+  double now = stats_clock_to_adapter (&clockSync, elapsed_us ());
+  double ahead = (now + guard + polls.period / 2 - polls.last) / polls.period;
+  unsigned int k = ahead > 0 ? (unsigned int)ahead + 1 : 1;
+  double deadline = stats_clock_to_host (&clockSync, polls.last + k * polls.period) - guard;
+
+  deadline += startTime.tv_sec * 1000000.0 + startTime.tv_nsec / 1000.0;
+  struct timespec ts;
+  ts.tv_sec = deadline / 1000000;
+  ts.tv_nsec = (deadline - ts.tv_sec * 1000000.0) * 1000;
+
+  if (gtimer_set_deadline (jitTimer, &ts) < 0)
+  {
+    return -1;
+  }
+  jitArmed = 1;
+  return 0;
+}
+
+/*
+ * Track the console poll period and phase, in adapter time.
+ */
+static int observe_poll(uint32_t clock)
+{
+  if (polls.count && clock == polls.lastClock)
+  {
+    return 0;
+  }
+
+  double t = (double)clock * FW_CLOCK_TICK_US;
+  if (polls.count)
+  {
+    double d = t - polls.last;
+    if (polls.count <= JIT_MIN_POLLS)
+    {
+      // the observed intervals are multiples of the poll period
+      if (d > 0 && (polls.period == 0 || d < polls.period))
+      {
+        polls.period = d;
+      }
+    }
+    else
+    {
+      unsigned int n = d / polls.period + 0.5;
+      if (n >= 1)
+      {
+        polls.period += (d / n - polls.period) / 16;
+      }
+    }
+  }
+  polls.last = t;
+  polls.lastClock = clock;
+  ++polls.count;
+
+  if (!jitArmed && jit_locked ())
+  {
+    return jit_schedule ();
+  }
+  return 0;
+}
+
+/*
+ * Account the Endpoint_ClearIN and poll times of an IN ack.
+ */
+static int process_in_ack(const unsigned char * value, unsigned char length, unsigned char credits)
+{
+  uint32_t poll = 0;
+  // old firmwares don't send the times
+  const unsigned char * times = value + offsetof(s_inAck, times);
+  uint8_t hasPoll = length >= offsetof(s_inAck, times) + (credits + 1) * sizeof(uint32_t);
+  if (hasPoll)
+  {
+    memcpy (&poll, times + credits * sizeof(uint32_t), sizeof(poll));
+  }
+  uint8_t newPoll = hasPoll && (!polls.count || poll != polls.lastClock);
+
+  if (newPoll && lastTaken.valid && clockSync.valid && (int32_t)(poll - lastTaken.clearIn) >= 0)
+  {
+    stats_hist_add (&ageHist, stats_clock_to_host (&clockSync, (double)poll * FW_CLOCK_TICK_US) - lastTaken.received);
+  }
+
+  unsigned char i;
+  for (i = 0; i < credits && inFlightHead != inFlightTail; ++i)
+  {
+    double received = inFlight[inFlightHead++];
+    if (length < offsetof(s_inAck, times) + (i + 1) * sizeof(uint32_t))
+    {
+      continue;
+    }
+    uint32_t clearIn;
+    memcpy (&clearIn, times + i * sizeof(uint32_t), sizeof(clearIn));
+    if (clockSync.valid)
+    {
+      stats_hist_add (&latencyHist, stats_clock_to_host (&clockSync, (double)clearIn * FW_CLOCK_TICK_US) - received);
+    }
+    if (hasClearIn)
+    {
+      stats_hist_add (&intervalHist, (uint32_t)(clearIn - lastClearIn) * FW_CLOCK_TICK_US);
+    }
+    lastClearIn = clearIn;
+    hasClearIn = 1;
+    lastTaken.received = received;
+    lastTaken.clearIn = clearIn;
+    lastTaken.valid = 1;
+  }
+
+  if (newPoll && clockSync.valid)
+  {
+    return observe_poll (poll);
+  }
+  return 0;
+}
+
+static void dump(unsigned char * data, unsigned char length)
+{
+  int i;
+  for (i = 0; i < length; ++i)
+  {
+    if(i && !(i % 8))
+    {
+      printf("\n");
+    }
+    printf("0x%02x ", data[i]);
+  }
+  printf("\n");
+}
+
+static int timer_close (int user) 
+{
+  done = 1;
+  return 1;
+}
+
+/*
+ * Stream the configuration of a mirror, the adapter answers the HID class requests itself.
+ */
+static int mirror_send_configuration (unsigned int i, int upload)
+{
+  mirrors[i].checksum = 0;
+  SPOOF_PKT * frame;
+  for (frame = mirrors[i].frames; frame->type != E_TYPE_RESET; ++frame)
+  {
+    if (!upload && (frame->type == E_TYPE_DESCRIPTORS || frame->type == E_TYPE_INDEX))
+    {
+      continue;
+    }
+    if (frame->type == E_TYPE_ENDPOINTS)
+    {
+      set_endpoint_flags ((s_endpointConfig *)frame->pkt, frame->len / sizeof(s_endpointConfig));
+    }
+    unsigned int j;
+    for (j = 0; j < frame->len; ++j)
+    {
+      mirrors[i].checksum = config_checksum (mirrors[i].checksum, frame->pkt[j]);
+    }
+    if (adapter_send (mirrors[i].adapter, frame->type, frame->pkt, frame->len) < 0)
+    {
+      return -1;
+    }
+  }
+  return adapter_send (mirrors[i].adapter, E_TYPE_FEATURES, NULL, 0);
+}
+
+static int process_mirror_packet(unsigned int i, s_packet * packet)
 {
-  unsigned char type = packet->header.type;
-  if (adapter_debug (0xff) & 0x0f)
-    fprintf (stdout, "\n#i:process pkt type 0x%x", type);
   int ret = 0;
 
   switch (packet->header.type)
   {
-  case E_TYPE_DESCRIPTORS:
-    if (spoof_device_index == -1)
-      ret = send_index ();
-    if (1 || adapter_debug (0xff) & 0x0f)
+  case E_TYPE_HASH:
+    ret = mirror_send_configuration (i, !(packet->header.length && packet->value[0]));
+    break;
+  case E_TYPE_ENDPOINTS:
+    if (packet->header.length >= sizeof(s_endpointsAck)
+        && ((s_endpointsAck *)packet->value)->checksum != mirrors[i].checksum)
     {
-      fprintf (stdout, "\n#i:ready descriptors");
-      fflush (stdout);
+      fprintf (stderr, "\n#e:mirror %04x:%04x: configuration checksum mismatch", mirrors[i].vid, mirrors[i].pid);
+      ret = -1;
+      break;
+    }
+    mirrors[i].credits = packet->header.length ? packet->value[0] : 1;
+    // as for the primary adapter, the reports don't age in the queue of the adapter
+    if (mirrors[i].credits > MAX_IN_FLIGHT)
+    {
+      mirrors[i].credits = MAX_IN_FLIGHT;
     }
+    mirrors[i].ready = 1;
+    printf ("\n#i:mirror %04x:%04x ready in %u ms", mirrors[i].vid, mirrors[i].pid, elapsed_ms ());
+    fflush (stdout);
+    break;
+  case E_TYPE_CONFIGURED:
+    printf ("\n#i:mirror %04x:%04x: console enumerated in %u ms", mirrors[i].vid, mirrors[i].pid, elapsed_ms ());
+    fflush (stdout);
+    break;
+  case E_TYPE_IN:
+    mirrors[i].credits += packet->header.length ? packet->value[0] : 1;
+    ret = mirror_flush (i);
+    break;
+  case E_TYPE_OUT:
+    // the force feedback comes from the primary adapter only
+    ++mirrors[i].ffbDropped;
     break;
-  case E_TYPE_INDEX:
-    if (spoof_device_index == -1)
-      ret = send_endpoints ();
-    if (1 || adapter_debug (0xff) & 0x0f)
+  case E_TYPE_CONTROL:
+    if (packet->header.length >= sizeof(struct usb_ctrlrequest)
+        && (((struct usb_ctrlrequest *)packet->value)->bRequestType & USB_DIR_IN))
     {
-      fprintf (stdout, "\n#i:ready indexes");
-      fflush (stdout);
+      ret = adapter_send (mirrors[i].adapter, E_TYPE_CONTROL_STALL, NULL, 0);
+    }
+    else
+    {
+      ret = adapter_send (mirrors[i].adapter, E_TYPE_CONTROL, NULL, 0);
     }
     break;
+  case E_TYPE_DEBUG:
+    dump (packet->value, packet->header.length);
+    break;
+  case E_TYPE_RESET:
+    ret = -1;
+    break;
+  default:
+    break;
+  }
+
+  if (ret < 0)
+  {
+    done = 1;
+  }
+  return ret;
+}
+
+static int process_packet(int user, s_packet * packet)
+{
+  unsigned char type = packet->header.type;
+  unsigned int mirror;
+  for (mirror = 0; mirror < nbMirrors; ++mirror)
+  {
+    if (user == mirrors[mirror].adapter)
+    {
+      return process_mirror_packet (mirror, packet);
+    }
+  }
+  if (adapter_debug (0xff) & 0x0f)
+    fprintf (stdout, "\n#i:process pkt type 0x%x", type);
+  int ret = 0;
+
+  switch (packet->header.type)
+  {
   case E_TYPE_ENDPOINTS:
-    if (spoof_device_index == -1)
+    if (packet->header.length >= sizeof(s_endpointsAck))
+    {
+      s_endpointsAck * endpointsAck = (s_endpointsAck *)packet->value;
+      if (endpointsAck->checksum != configChecksum)
+      {
+        fprintf (stderr, "\n#e:configuration checksum mismatch (adapter 0x%04x, expected 0x%04x)", endpointsAck->checksum, configChecksum);
+        ret = -1;
+        break;
+      }
+    }
+    if (spoofFrames == NULL)
       gtimer_close (init_timer);
     init_timer = -1;
-    printf ("\n#i:ready");
+    // old firmwares don't advertise their IN slots
+    inCredits = packet->header.length ? packet->value[0] : 1;
+    printf ("\n#i:ready in %u ms (%hhu IN slots)", elapsed_ms (), inCredits);
+    if (inCredits > MAX_IN_FLIGHT)
+    {
+      inCredits = MAX_IN_FLIGHT;
+    }
     fflush (stdout);
     ret = poll_all_endpoints ();
     break;
-  case E_TYPE_IN:
-    if (inPending > 0) 
+  case E_TYPE_HASH:
     {
-      ret = gusb_poll (usb, inPending);
-      inPending = 0;
-      if (ret != -1) 
+      int upload = !(packet->header.length && packet->value[0]);
+      printf (upload ? "\n#i:uploading the descriptors" : "\n#i:descriptors already stored in the adapter");
+      if (upload && init_timer >= 0)
       {
-        ret = send_next_in_packet ();
-        if (adapter_debug (0xff) & 0x0f)
+        // the adapter writes them to its EEPROM before the ack
+        gtimer_close (init_timer);
+        init_timer = gtimer_start (0, UPLOAD_TIMEOUT, timer_close, timer_close, gpoll_register_fd);
+        if (init_timer < 0)
         {
-          fprintf (stdout, "\n#i:next IN packet");
-          fflush (stdout);
+          ret = -1;
+          break;
         }
       }
+      ret = send_configuration (upload);
+    }
+    break;
+  case E_TYPE_CONFIGURED:
+    printf ("\n#i:console enumerated in %u ms", elapsed_ms ());
+    fflush (stdout);
+    break;
+  case E_TYPE_IN:
+    {
+      unsigned char credits = packet->header.length ? packet->value[0] : 1;
+      ret = process_in_ack (packet->value, packet->header.length, credits);
+      inCredits += credits;
+    }
+    if (ret >= 0 && !jit_locked ())
+    {
+      ret = send_next_in_packet ();
+    }
+    if (adapter_debug (0xff) & 0x0f)
+    {
+      fprintf (stdout, "\n#i:next IN packet (%hhu credits)", inCredits);
+      fflush (stdout);
     }
     break;
   case E_TYPE_OUT:
@@ -2316,6 +3402,26 @@ static int process_packet(int user, s_packet * packet)
       dump (packet->value, packet->header.length);
     }
     break;
+  case E_TYPE_COUNTERS:
+    if (packet->header.length >= sizeof(inStats.adapter))
+    {
+      s_counters previous = inStats.adapter;
+      memcpy (&inStats.adapter, packet->value, sizeof(inStats.adapter));
+      if (showStats)
+      {
+        print_counters (&inStats.adapter, &previous);
+      }
+    }
+    break;
+  case E_TYPE_PING:
+    if (pingSent >= 0 && packet->header.length >= sizeof(uint32_t))
+    {
+      uint32_t clock;
+      memcpy (&clock, packet->value, sizeof(clock));
+      stats_clock_add (&clockSync, pingSent, elapsed_us (), (double)clock * FW_CLOCK_TICK_US);
+      pingSent = -1;
+    }
+    break;
   case E_TYPE_RESET:
     ret = -1;
     break;
@@ -2355,6 +3461,17 @@ void print_endpoints()
 int proxy_init (int vid, int pid) 
 {
 
+  clock_gettime (CLOCK_MONOTONIC, &startTime);
+
+  if (fakeWheel)
+  {
+    descriptors = fakewheel_get_usb_descriptors ();
+    printf("\n#i:using the fake wheel: VID 0x%04x PID 0x%04x", descriptors->device.idVendor, descriptors->device.idProduct);
+    fix_endpoints ();
+    print_endpoints ();
+    return 0;
+  }
+
   char * path = usb_select (vid, pid);
 
   if (path == NULL) 
@@ -2402,12 +3519,6 @@ int proxy_init (int vid, int pid)
   return 0;
 }
 
-static int timer_close (int user) 
-{
-  done = 1;
-  return 1;
-}
-
 static int timer_read (int user) 
 {
   /*
@@ -2417,88 +3528,764 @@ static int timer_read (int user)
   return 1;
 }
 
-int proxy_start (char * port) 
+static int ping_read (int user)
 {
-
-  int ret = set_prio ();
-  if (ret < 0)
+  double now = elapsed_us ();
+  // old firmwares don't answer
+  if (pingSent < 0 || now - pingSent > PING_TIMEOUT)
   {
-    PRINT_ERROR_OTHER ("\n#e:failed to set process priority!")
-    return -1;
+    if (adapter_send (adapter, E_TYPE_PING, NULL, 0) < 0)
+    {
+      done = 1;
+      return 1;
+    }
+    pingSent = now;
   }
+  return 0;
+}
 
-  adapter = adapter_open (port, process_packet, adapter_send_callback, adapter_close_callback);
-
-  //adapter_send (adapter, E_TYPE_RESET, NULL, 0);
+static int jit_read (int user)
+{
+  jitArmed = 0;
+  if (send_next_in_packet () < 0 || jit_schedule () < 0)
+  {
+    done = 1;
+    return 1;
+  }
+  return 0;
+}
 
-  if(adapter < 0) 
+static void print_timing ()
+{
+  if (clockSync.valid)
   {
-    return -1;
+    printf ("\n#s:adapter clock: drift %.1f ppm, best ping %.0f us", clockSync.drift * 1000000, clockSync.minRtt);
   }
-  if (1|| adapter_debug (0xff) & 0x0f)
-    printf ("\n#i:sending descriptors");
-  if (send_descriptors () < 0)
+  if (polls.period > 0)
   {
-    return -1;
+    printf ("\n#s:console poll period %.0f us", polls.period);
   }
-  //
-  if (spoof_device_index != -1)
+  stats_hist_print (stdout, &latencyHist);
+  stats_hist_print (stdout, &intervalHist);
+  stats_hist_print (stdout, &ageHist);
+  if (nbInputs)
   {
-    //send spoof device
-    //spoof_len = sizeof (ft_0eb7_0e04);
-    //printf("\n#spoof dev len %d", spoof_len);
-    int lk = spoof_device_index;
-    while (devs_spoof[lk].type != E_TYPE_RESET)
-    {
-      printf("\n#spoof dev data %d type %02X", lk, devs_spoof[lk].type);
-      if (adapter_send (adapter, devs_spoof[lk].type, devs_spoof[lk].pkt, devs_spoof[lk].len) < 0)
-      {
-        printf("\n#!ERR:spoof dev data %d type %02X", lk, devs_spoof[lk].type);
-        return -1;
-      }
-      lk++;
-    }
+    stats_hist_print (stdout, &skewHist);
   }
 
-  if (spoof_device_index == -1)
+  if (histogramFile != NULL)
   {
-    init_timer = gtimer_start (0, 1000000, timer_close, timer_close, gpoll_register_fd);
-    if (init_timer < 0) 
+    FILE * file = fopen (histogramFile, "w");
+    if (file == NULL)
     {
-      return -1;
+      fprintf (stderr, "\n#e:can't open %s", histogramFile);
+      return;
     }
+    fprintf (file, "histogram,from_us,to_us,count\n");
+    stats_hist_export (file, &latencyHist);
+    stats_hist_export (file, &intervalHist);
+    stats_hist_export (file, &ageHist);
+    if (nbInputs)
+    {
+      stats_hist_export (file, &skewHist);
+    }
+    fclose (file);
   }
+}
 
-  if (adapter_debug (0xff) & 0x0f)
+/*
+ * Compile the remap of the spoofed device, or the one loaded from the --remap file.
+ */
+static int compile_remap ()
+{
+  if (spoof_handlers_index == -1 || spoof_handlers[spoof_handlers_index].whl == NULL)
   {
-    printf ("\n#i:started init timer");
+    if (customRemapCount >= 0)
+    {
+      PRINT_ERROR_OTHER ("--remap requires a --spoof device with a report converter")
+      return -1;
+    }
+    return 0;
   }
-  ret = gusb_register (usb, 0, usb_read_callback, usb_write_callback, usb_close_callback, gpoll_register_fd);
-  if (ret < 0)
+  const s_remapEntry * entries = customRemap;
+  unsigned int count = customRemapCount;
+  if (customRemapCount < 0)
   {
-    return -1;
+    entries = spoof_handlers[spoof_handlers_index].whl_remap;
+    for (count = 0; entries[count].dstMask; ++count) {}
   }
+  return remap_compile (&whlRemap, entries, count, sizeof(s_endpointPacket), spoof_handlers[spoof_handlers_index].whl_report_len);
+}
 
-  if (adapter_debug (0xff) & 0x0f)
+/*
+ * Compile the decode plan from the report descriptor of the wheel.
+ */
+static int compile_decode ()
+{
+  if (!decode)
   {
-    printf ("\n#i:started polling timer");
+    return 0;
   }
-  int timer = gtimer_start (0, 10000, timer_read, timer_close, gpoll_register_fd);
-  if (timer < 0) 
+  if (spoof_handlers_index == -1 || spoof_handlers[spoof_handlers_index].whl == NULL)
   {
+    PRINT_ERROR_OTHER ("--decode requires a --spoof device with a report converter")
     return -1;
   }
-
-  while (!done) 
+  unsigned int descNumber;
+  for (descNumber = 0; descNumber < descriptors->nbOthers; ++descNumber)
   {
-    gpoll ();
-  }
-
-  printf ("\n#i:cleaning up");
-  gtimer_close (timer);
-  adapter_send (adapter, E_TYPE_RESET, NULL, 0);
-  gusb_close (usb);
+    if ((descriptors->others[descNumber].wValue >> 8) == HID_DT_REPORT)
+    {
+      if (hidplan_compile (&whlPlan, descriptors->others[descNumber].data, descriptors->others[descNumber].wLength, whlDecodeTargets) < 0)
+      {
+        return -1;
+      }
+      hidplan_print (&whlPlan);
+      return 0;
+    }
+  }
+  PRINT_ERROR_OTHER ("the wheel has no report descriptor")
+  return -1;
+}
+
+/*
+ * Find the report descriptor and the first IN interrupt endpoint of a device.
+ */
+static const struct p_other * input_report_descriptor (const s_usb_descriptors * desc, uint8_t * endpoint)
+{
+  *endpoint = 0;
+  const struct p_configuration * configuration = desc->configurations;
+  unsigned int i, j;
+  for (i = 0; i < configuration->descriptor->bNumInterfaces && *endpoint == 0; ++i)
+  {
+    if (configuration->interfaces[i].bNumAltInterfaces == 0)
+    {
+      continue;
+    }
+    const struct p_altInterface * altInterface = configuration->interfaces[i].altInterfaces;
+    for (j = 0; j < altInterface->bNumEndpoints; ++j)
+    {
+      const struct usb_endpoint_descriptor * ep = altInterface->endpoints[j];
+      if ((ep->bEndpointAddress & USB_ENDPOINT_DIR_MASK) == USB_DIR_IN
+          && (ep->bmAttributes & USB_ENDPOINT_XFERTYPE_MASK) == USB_ENDPOINT_XFER_INT
+          && ep->wMaxPacketSize <= MAX_PAYLOAD_SIZE_EP)
+      {
+        *endpoint = ep->bEndpointAddress;
+        break;
+      }
+    }
+  }
+  for (i = 0; i < desc->nbOthers; ++i)
+  {
+    if ((desc->others[i].wValue >> 8) == HID_DT_REPORT)
+    {
+      return desc->others + i;
+    }
+  }
+  return NULL;
+}
+
+static unsigned int decode_target_role (const s_hidplanTarget * target)
+{
+  switch (target->kind)
+  {
+  case HIDPLAN_HAT:
+    return INPUT_ROLE_HAT;
+  case HIDPLAN_BUTTON:
+    return INPUT_ROLE_BUTTONS;
+  default:
+    break;
+  }
+  switch (target->dstByte)
+  {
+  case G29_WHEEL_IDX:
+    return INPUT_ROLE_WHEEL;
+  case G29_GAS_IDX:
+    return INPUT_ROLE_GAS;
+  case G29_BRAKE_IDX:
+    return INPUT_ROLE_BRAKE;
+  }
+  return 0;
+}
+
+/*
+ * Gather the decode targets of the roles of an input, the buttons and the hat
+ * are merged into the wheel state instead of replacing it.
+ *
+ * \return the number of targets, the list ends with a HIDPLAN_NONE one
+ */
+static unsigned int input_targets (unsigned int roles, s_hidplanTarget * targets)
+{
+  unsigned int nbTargets = 0;
+  unsigned int j;
+  for (j = 0; whlDecodeTargets[j].kind != HIDPLAN_NONE; ++j)
+  {
+    if (decode_target_role (whlDecodeTargets + j) & roles)
+    {
+      targets[nbTargets++] = whlDecodeTargets[j];
+    }
+  }
+  for (j = 0; (roles & INPUT_ROLE_GEAR) && gearDecodeTargets[j].kind != HIDPLAN_NONE; ++j)
+  {
+    targets[nbTargets++] = gearDecodeTargets[j];
+  }
+  for (j = 0; j < nbTargets; ++j)
+  {
+    if (targets[j].kind == HIDPLAN_BUTTON)
+    {
+      targets[j].kind = HIDPLAN_MERGED_BUTTON;
+    }
+    else if (targets[j].kind == HIDPLAN_HAT)
+    {
+      targets[j].kind = HIDPLAN_MERGED_HAT;
+    }
+  }
+  targets[nbTargets].kind = HIDPLAN_NONE;
+  return nbTargets;
+}
+
+/*
+ * Open the --input devices, and compile their decode plans from the targets of their roles.
+ */
+static int open_inputs ()
+{
+  if (nbInputs && (spoof_handlers_index == -1 || spoof_handlers[spoof_handlers_index].whl == NULL))
+  {
+    PRINT_ERROR_OTHER ("--input requires a --spoof device with a report converter")
+    return -1;
+  }
+  unsigned int i;
+  for (i = 0; i < nbInputs; ++i)
+  {
+    char * path = usb_select (inputs[i].vid, inputs[i].pid);
+    if (path == NULL)
+    {
+      return -1;
+    }
+    inputs[i].usb = gusb_open_path (path);
+    if (inputs[i].usb < 0)
+    {
+      free (path);
+      return -1;
+    }
+    printf ("\n#i:using input: VID 0x%04x PID 0x%04x PATH %s", inputs[i].vid, inputs[i].pid, path);
+    free (path);
+
+    s_usb_descriptors * desc = gusb_get_usb_descriptors (inputs[i].usb);
+    if (desc == NULL || desc->device.bNumConfigurations == 0)
+    {
+      PRINT_ERROR_OTHER ("the input has no configuration")
+      return -1;
+    }
+    const struct p_other * report = input_report_descriptor (desc, &inputs[i].endpoint);
+    if (report == NULL || inputs[i].endpoint == 0)
+    {
+      PRINT_ERROR_OTHER ("the input has no report descriptor or no IN interrupt endpoint")
+      return -1;
+    }
+
+    s_hidplanTarget targets[sizeof(whlDecodeTargets) / sizeof(*whlDecodeTargets) + sizeof(gearDecodeTargets) / sizeof(*gearDecodeTargets)];
+    input_targets (inputs[i].roles, targets);
+    if (hidplan_compile (&inputs[i].plan, report->data, report->wLength, targets) < 0)
+    {
+      return -1;
+    }
+    hidplan_print (&inputs[i].plan);
+  }
+  return 0;
+}
+
+int input_read_callback (int user, unsigned char endpoint, const void * buf, int status)
+{
+  switch (status)
+  {
+  case E_TRANSFER_TIMED_OUT:
+    PRINT_TRANSFER_READ_ERROR (endpoint, "TIMEOUT")
+    break;
+  case E_TRANSFER_STALL:
+    break;
+  case E_TRANSFER_ERROR:
+    PRINT_TRANSFER_READ_ERROR (endpoint, "OTHER ERROR")
+    return -1;
+  default:
+    break;
+  }
+
+  if (status > MAX_PAYLOAD_SIZE_EP)
+  {
+    PRINT_ERROR_OTHER ("too many bytes transfered")
+    done = 1;
+    return -1;
+  }
+
+  if (status > 0)
+  {
+    double now = elapsed_us ();
+    memcpy (inputs[user].report, buf, status);
+    inputs[user].length = status;
+    inputs[user].time = now;
+    requeue_in_packet (now);
+    if (mirror_reports () < 0)
+    {
+      done = 1;
+      return -1;
+    }
+  }
+
+  if (gusb_poll (inputs[user].usb, endpoint) < 0)
+  {
+    done = 1;
+    return -1;
+  }
+
+  if (status > 0 && !jit_locked () && send_next_in_packet () < 0)
+  {
+    done = 1;
+    return -1;
+  }
+
+  return 0;
+}
+
+int input_write_callback (int user, unsigned char endpoint, int status)
+{
+  return 0;
+}
+
+/*
+ * Apply the --rewrite overrides to the descriptors the adapter will present.
+ * The frames of the spoofed device are gathered into the rewrite buffers first,
+ * as they may be the built-in ones or a read-only profile.
+ */
+static int rewrite_descriptors ()
+{
+  if (!descrewrite_is_set (&descRewrite))
+  {
+    return 0;
+  }
+
+  if (spoofFrames == NULL)
+  {
+    unsigned int length = pDesc - desc;
+    if (descrewrite_apply (&descRewrite, desc, &length, descIndex, pDescIndex - descIndex,
+        endpoints, pEndpoints - endpoints, 0) < 0)
+    {
+      return -1;
+    }
+    pDesc = desc + length;
+    return 0;
+  }
+
+  unsigned int length = 0;
+  unsigned int nbIndex = 0;
+  unsigned int nbEndpoints = 0;
+  const SPOOF_PKT * frame;
+  for (frame = spoofFrames; frame->type != E_TYPE_RESET; ++frame)
+  {
+    unsigned char * target = NULL;
+    unsigned int available = 0;
+    switch (frame->type)
+    {
+    case E_TYPE_DESCRIPTORS:
+      target = rewrittenDesc + length;
+      available = sizeof(rewrittenDesc) - length;
+      break;
+    case E_TYPE_INDEX:
+      target = (unsigned char *)(rewrittenIndex + nbIndex);
+      available = sizeof(rewrittenIndex) - nbIndex * sizeof(*rewrittenIndex);
+      break;
+    case E_TYPE_ENDPOINTS:
+      target = (unsigned char *)rewrittenEndpoints;
+      available = sizeof(rewrittenEndpoints);
+      nbEndpoints = 0;
+      break;
+    default:
+      PRINT_ERROR_OTHER ("unexpected frame in the spoofed configuration")
+      return -1;
+    }
+    if (frame->len > available)
+    {
+      PRINT_ERROR_OTHER ("the spoofed configuration is too large")
+      return -1;
+    }
+    memcpy (target, frame->pkt, frame->len);
+    switch (frame->type)
+    {
+    case E_TYPE_DESCRIPTORS:
+      length += frame->len;
+      break;
+    case E_TYPE_INDEX:
+      nbIndex += frame->len / sizeof(*rewrittenIndex);
+      break;
+    case E_TYPE_ENDPOINTS:
+      nbEndpoints = frame->len / sizeof(*rewrittenEndpoints);
+      break;
+    }
+  }
+
+  // the converted reports are sent instead of the ones of the report descriptor
+  unsigned int inLength = 0;
+  if (spoof_handlers_index != -1 && spoof_handlers[spoof_handlers_index].whl != NULL)
+  {
+    inLength = spoof_handlers[spoof_handlers_index].whl_report_len - 1;
+  }
+  if (descrewrite_apply (&descRewrite, rewrittenDesc, &length, rewrittenIndex, nbIndex, rewrittenEndpoints, nbEndpoints, inLength) < 0)
+  {
+    return -1;
+  }
+
+  rewrittenFrames[0] = (SPOOF_PKT) { E_TYPE_DESCRIPTORS, length, rewrittenDesc };
+  rewrittenFrames[1] = (SPOOF_PKT) { E_TYPE_INDEX, nbIndex * sizeof(*rewrittenIndex), (unsigned char *)rewrittenIndex };
+  rewrittenFrames[2] = (SPOOF_PKT) { E_TYPE_ENDPOINTS, nbEndpoints * sizeof(*rewrittenEndpoints), (unsigned char *)rewrittenEndpoints };
+  rewrittenFrames[3] = (SPOOF_PKT) { E_TYPE_RESET, 0, NULL };
+  spoofFrames = rewrittenFrames;
+
+  return 0;
+}
+
+/*
+ * Save the identity of the spoofed device, or of the proxied one, as a spoof profile.
+ */
+static int save_profile ()
+{
+  if (spoofFrames != NULL)
+  {
+    int handlerVid = 0;
+    int handlerPid = 0;
+    if (spoof_handlers_index != -1)
+    {
+      handlerVid = spoof_handlers[spoof_handlers_index].vid;
+      handlerPid = spoof_handlers[spoof_handlers_index].pid;
+    }
+    return spoof_profile_save (saveProfileDir, spoofVid, spoofPid, handlerVid, handlerPid, spoofFrames);
+  }
+  SPOOF_PKT frames[] =
+  {
+    { E_TYPE_DESCRIPTORS, pDesc - desc, desc },
+    { E_TYPE_INDEX, (pDescIndex - descIndex) * sizeof(*descIndex), (unsigned char *)&descIndex },
+    { E_TYPE_ENDPOINTS, (pEndpoints - endpoints) * sizeof(*endpoints), (unsigned char *)&endpoints },
+    { E_TYPE_RESET, 0, NULL },
+  };
+  return spoof_profile_save (saveProfileDir, descriptors->device.idVendor, descriptors->device.idProduct, 0, 0, frames);
+}
+
+/*
+ * The converter generated from the profile of a spoof handler, NULL if there is none.
+ */
+static const s_generatedConverter * find_generated_converter (int handler)
+{
+  const s_generatedConverter * converter;
+  for (converter = generatedConverters; converter->whl != NULL; ++converter)
+  {
+    if (converter->vid == spoof_handlers[handler].vid && converter->pid == spoof_handlers[handler].pid)
+    {
+      return converter;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Build the axis tables of the output maxima of a converter, before any report is converted.
+ */
+static int build_axes (const long max[AXIS_NB])
+{
+  unsigned int i;
+  for (i = 0; i < AXIS_NB; ++i)
+  {
+    if (max[i] && axis_build (&whlAxes[i], max[i]) < 0)
+    {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Select the converter of the spoofed device, and build its axis tables.
+ */
+static int select_converter ()
+{
+  if (spoof_handlers_index == -1 || spoof_handlers[spoof_handlers_index].whl == NULL)
+  {
+    if (generated)
+    {
+      PRINT_ERROR_OTHER ("--generated requires a --spoof device with a report converter")
+      return -1;
+    }
+    return 0;
+  }
+  whlConvert = spoof_handlers[spoof_handlers_index].whl;
+  if (!generated)
+  {
+    return build_axes (spoof_handlers[spoof_handlers_index].whl_axes);
+  }
+  if (customRemapCount >= 0)
+  {
+    PRINT_ERROR_OTHER ("the generated converters have their remap built in, --remap can't be used with --generated")
+    return -1;
+  }
+  const s_generatedConverter * converter = find_generated_converter (spoof_handlers_index);
+  if (converter == NULL)
+  {
+    PRINT_ERROR_OTHER ("no generated converter for the spoofed device")
+    return -1;
+  }
+  whlConvert = converter->whl;
+  printf ("\n#i:using the converter generated from %s", converter->profile);
+  return build_axes (converter->max);
+}
+
+/*
+ * Open the --mirror adapters, and ask them if they store the descriptors of their device.
+ */
+static int open_mirrors ()
+{
+  if (nbMirrors && whlConvert == NULL)
+  {
+    PRINT_ERROR_OTHER ("--mirror requires a --spoof device with a report converter")
+    return -1;
+  }
+  unsigned int i;
+  for (i = 0; i < nbMirrors; ++i)
+  {
+    int handler;
+    mirrors[i].frames = find_spoof_device (mirrors[i].vid, mirrors[i].pid, &mirrors[i].profile, &handler);
+    if (mirrors[i].frames == NULL)
+    {
+      fprintf (stderr, "\n#e:mirror %04x:%04x: unknown spoofed device", mirrors[i].vid, mirrors[i].pid);
+      return -1;
+    }
+    const s_generatedConverter * converter = handler == -1 ? NULL : find_generated_converter (handler);
+    if (converter == NULL)
+    {
+      fprintf (stderr, "\n#e:mirror %04x:%04x: no generated converter for the spoofed device", mirrors[i].vid, mirrors[i].pid);
+      return -1;
+    }
+    if (build_axes (converter->max) < 0)
+    {
+      return -1;
+    }
+    mirrors[i].convert = converter->whl;
+    mirrors[i].frame.header.type = E_TYPE_IN;
+    mirrors[i].frame.header.length = spoof_handlers[handler].whl_report_len;
+    memcpy (mirrors[i].frame.value, spoof_handlers[handler].whl_report, spoof_handlers[handler].whl_report_len);
+    printf ("\n#i:mirror %04x:%04x on %s, using the converter generated from %s",
+        mirrors[i].vid, mirrors[i].pid, mirrors[i].port, converter->profile);
+
+    mirrors[i].adapter = adapter_open (mirrors[i].port, process_packet, adapter_send_callback, adapter_close_callback);
+    if (mirrors[i].adapter < 0)
+    {
+      return -1;
+    }
+    uint32_t hash = config_hash_frames (mirrors[i].frames);
+    if (adapter_send (mirrors[i].adapter, E_TYPE_HASH, (unsigned char *)&hash, sizeof(hash)) < 0)
+    {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int proxy_start (char * port) 
+{
+
+  int ret = set_prio ();
+  if (ret < 0)
+  {
+    PRINT_ERROR_OTHER ("\n#e:failed to set process priority!")
+    return -1;
+  }
+
+  if (compile_remap () < 0)
+  {
+    return -1;
+  }
+
+  if (compile_decode () < 0)
+  {
+    return -1;
+  }
+
+  if (select_converter () < 0)
+  {
+    return -1;
+  }
+
+  if (open_inputs () < 0)
+  {
+    return -1;
+  }
+
+  adapter = adapter_open (port, process_packet, adapter_send_callback, adapter_close_callback);
+
+  //adapter_send (adapter, E_TYPE_RESET, NULL, 0);
+
+  if(adapter < 0) 
+  {
+    return -1;
+  }
+  if (prepare_descriptors () < 0)
+  {
+    return -1;
+  }
+
+  if (rewrite_descriptors () < 0)
+  {
+    return -1;
+  }
+
+  if (saveProfileDir != NULL && save_profile () < 0)
+  {
+    return -1;
+  }
+
+  // the configuration is sent once the adapter tells if it has these descriptors
+  uint32_t hash = config_hash_descriptors ();
+  if (adapter_send (adapter, E_TYPE_HASH, (unsigned char *)&hash, sizeof(hash)) < 0)
+  {
+    return -1;
+  }
+
+  if (open_mirrors () < 0)
+  {
+    return -1;
+  }
+
+  if (spoofFrames == NULL)
+  {
+    init_timer = gtimer_start (0, INIT_TIMEOUT, timer_close, timer_close, gpoll_register_fd);
+    if (init_timer < 0) 
+    {
+      return -1;
+    }
+  }
+
+  if (adapter_debug (0xff) & 0x0f)
+  {
+    printf ("\n#i:started init timer");
+  }
+  if (fakeWheel)
+  {
+    ret = fakewheel_register (0, usb_read_callback, usb_write_callback, usb_close_callback, gpoll_register_fd);
+  }
+  else
+  {
+    ret = gusb_register (usb, 0, usb_read_callback, usb_write_callback, usb_close_callback, gpoll_register_fd);
+  }
+  if (ret < 0)
+  {
+    return -1;
+  }
+  unsigned int input;
+  for (input = 0; input < nbInputs; ++input)
+  {
+    if (gusb_register (inputs[input].usb, input, input_read_callback, input_write_callback, usb_close_callback, gpoll_register_fd) < 0)
+    {
+      return -1;
+    }
+  }
+
+  if (adapter_debug (0xff) & 0x0f)
+  {
+    printf ("\n#i:started polling timer");
+  }
+  int timer = gtimer_start (0, 10000, timer_read, timer_close, gpoll_register_fd);
+  if (timer < 0) 
+  {
+    return -1;
+  }
+
+  int pingTimer = -1;
+  if (showStats || histogramFile != NULL || jit)
+  {
+    stats_clock_init (&clockSync);
+    stats_hist_init (&latencyHist, "latency", HIST_BIN_US);
+    stats_hist_init (&intervalHist, "interval", HIST_BIN_US);
+    stats_hist_init (&ageHist, "age", HIST_BIN_US);
+    if (nbInputs)
+    {
+      stats_hist_init (&skewHist, "skew", HIST_BIN_US);
+    }
+    pingTimer = gtimer_start (0, PING_PERIOD, ping_read, timer_close, gpoll_register_fd);
+    if (pingTimer < 0)
+    {
+      return -1;
+    }
+  }
+
+  if (jit)
+  {
+    // armed once the console polls are predictable
+    jitTimer = gtimer_start (0, 0, jit_read, timer_close, gpoll_register_fd);
+    if (jitTimer < 0)
+    {
+      return -1;
+    }
+  }
+
+  while (!done) 
+  {
+    gpoll ();
+  }
+
+  printf ("\n#i:cleaning up");
+  if (cachedIn)
+  {
+    printf ("\n#i:IN reports: %u sent, %u unchanged, %u polls served from the adapter cache",
+        inStats.sent, inStats.unchanged, inStats.adapter.cachedPolls);
+  }
+  printf ("\n#i:IN reports: %u replaced by a newer one before being sent", inStats.coalesced);
+  if (localHid)
+  {
+    printf ("\n#i:%u control requests answered by the adapter", inStats.adapter.localControls);
+  }
+  printf ("\n#i:adapter: IN %u sent %u NAK, OUT %u sent %u NAK, ctl %u relayed %u timeout, rx overruns %u",
+      inStats.adapter.inPackets, inStats.adapter.inNaks, inStats.adapter.outPackets, inStats.adapter.outNaks,
+      inStats.adapter.controlRelayed, inStats.adapter.controlTimeouts, inStats.adapter.rxOverruns);
+  if (ctlTtl)
+  {
+    printf ("\n#i:control cache: %u hits, %u misses, %u invalidations", ctlStats.hits, ctlStats.misses, ctlStats.invalidations);
+  }
+  unsigned int mirror;
+  for (mirror = 0; mirror < nbMirrors; ++mirror)
+  {
+    printf ("\n#i:mirror %04x:%04x: IN %u sent %u replaced before being sent, %u OUT dropped",
+        mirrors[mirror].vid, mirrors[mirror].pid, mirrors[mirror].sent, mirrors[mirror].coalesced, mirrors[mirror].ffbDropped);
+    if (mirrors[mirror].adapter >= 0)
+    {
+      adapter_send (mirrors[mirror].adapter, E_TYPE_RESET, NULL, 0);
+    }
+  }
+  if (pingTimer >= 0)
+  {
+    print_timing ();
+    gtimer_close (pingTimer);
+  }
+  if (jitTimer >= 0)
+  {
+    gtimer_close (jitTimer);
+  }
+  gtimer_close (timer);
+  adapter_send (adapter, E_TYPE_RESET, NULL, 0);
+  if (fakeWheel)
+  {
+    fakewheel_close ();
+  }
+  else
+  {
+    gusb_close (usb);
+  }
+  for (input = 0; input < nbInputs; ++input)
+  {
+    gusb_close (inputs[input].usb);
+  }
   adapter_close ();
+  for (mirror = 0; mirror < nbMirrors; ++mirror)
+  {
+    spoof_profile_unload (&mirrors[mirror].profile);
+  }
+  spoof_profile_unload (&spoofProfile);
   
   if (init_timer >= 0) 
   {
@@ -2516,3 +4303,191 @@ void proxy_stop ()
 {
   done = 1;
 }
+
+void proxy_set_cached_in (int enable)
+{
+  cachedIn = enable ? 1 : 0;
+}
+
+void proxy_set_stats (int enable)
+{
+  showStats = enable ? 1 : 0;
+}
+
+void proxy_set_jit (int enable)
+{
+  jit = enable ? 1 : 0;
+}
+
+void proxy_set_histograms (const char * file)
+{
+  histogramFile = file;
+}
+
+void proxy_set_single_bank (int enable)
+{
+  singleBank = enable ? 1 : 0;
+}
+
+void proxy_set_local_hid (int enable)
+{
+  localHid = enable ? 1 : 0;
+}
+
+void proxy_set_ctl_ttl (unsigned int ms)
+{
+  ctlTtl = ms;
+}
+
+void proxy_add_cached_report (unsigned char reportId)
+{
+  FEATURE_SET (cachedReports, reportId);
+}
+
+void proxy_add_static_feature (unsigned char reportId)
+{
+  localHid = 1;
+  FEATURE_SET (staticFeatures, reportId);
+}
+
+int proxy_set_latch_mask (const char * hex)
+{
+  unsigned int length = 0;
+  unsigned int byte;
+  while (*hex)
+  {
+    if (length == sizeof(latchMask) || !isxdigit ((unsigned char)hex[0]) || !isxdigit ((unsigned char)hex[1]))
+    {
+      return -1;
+    }
+    sscanf (hex, "%2x", &byte);
+    latchMask[length++] = byte;
+    hex += 2;
+  }
+  latchMaskLength = length;
+  return 0;
+}
+
+void proxy_set_profile_dir (const char * dir)
+{
+  profileDir = dir;
+}
+
+void proxy_set_save_profile_dir (const char * dir)
+{
+  saveProfileDir = dir;
+}
+
+int proxy_set_rewrite (const char * spec)
+{
+  return descrewrite_parse (&descRewrite, spec);
+}
+
+void proxy_set_generated (int enable)
+{
+  generated = enable ? 1 : 0;
+}
+
+void proxy_set_decode (int enable)
+{
+  decode = enable ? 1 : 0;
+}
+
+void proxy_set_fake_wheel (int enable)
+{
+  fakeWheel = enable ? 1 : 0;
+}
+
+int proxy_set_axis (const char * spec)
+{
+  unsigned int i;
+  for (i = 0; i < AXIS_NB; ++i)
+  {
+    size_t length = strlen (axisNames[i]);
+    if (!strncmp (spec, axisNames[i], length) && spec[length] == ':')
+    {
+      return axis_parse (&whlAxes[i], spec + length + 1);
+    }
+  }
+  return -1;
+}
+
+/*
+ * Add a mirror adapter, e.g. 046d:c294:/dev/ttyUSB1
+ */
+int proxy_add_mirror (const char * spec)
+{
+  if (nbMirrors == MAX_MIRRORS)
+  {
+    return -1;
+  }
+  unsigned int vid, pid;
+  int length = 0;
+  if (sscanf (spec, "%4x:%4x:%n", &vid, &pid, &length) < 2 || length == 0 || spec[length] == '\0')
+  {
+    return -1;
+  }
+  mirrors[nbMirrors].vid = vid;
+  mirrors[nbMirrors].pid = pid;
+  mirrors[nbMirrors].port = spec + length;
+  mirrors[nbMirrors].adapter = -1;
+  ++nbMirrors;
+  return 0;
+}
+
+/*
+ * Add an input device, e.g. 0eb7:183b:gas,brake
+ */
+int proxy_add_input (const char * spec)
+{
+  if (nbInputs == MAX_INPUTS)
+  {
+    return -1;
+  }
+  unsigned int vid, pid;
+  int length = 0;
+  if (sscanf (spec, "%4x:%4x:%n", &vid, &pid, &length) < 2 || length == 0)
+  {
+    return -1;
+  }
+  unsigned int roles = 0;
+  const char * role = spec + length;
+  while (*role)
+  {
+    unsigned int i;
+    size_t roleLength = strcspn (role, ",");
+    for (i = 0; i < sizeof(inputRoleNames) / sizeof(*inputRoleNames); ++i)
+    {
+      if (strlen (inputRoleNames[i]) == roleLength && !strncmp (role, inputRoleNames[i], roleLength))
+      {
+        break;
+      }
+    }
+    if (i == sizeof(inputRoleNames) / sizeof(*inputRoleNames))
+    {
+      return -1;
+    }
+    roles |= 1 << i;
+    role += roleLength;
+    if (*role == ',')
+    {
+      ++role;
+    }
+  }
+  // the gears are read from the buttons of the shifter
+  if (roles == 0 || ((roles & INPUT_ROLE_GEAR) && (roles & INPUT_ROLE_BUTTONS)))
+  {
+    return -1;
+  }
+  inputs[nbInputs].vid = vid;
+  inputs[nbInputs].pid = pid;
+  inputs[nbInputs].roles = roles;
+  ++nbInputs;
+  return 0;
+}
+
+int proxy_set_remap (const char * file)
+{
+  customRemapCount = remap_load (file, customRemap, sizeof(customRemap) / sizeof(*customRemap));
+  return customRemapCount < 0 ? -1 : 0;
+}
@@ -0,0 +1,156 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#include <remap.h>
+#include <stdio.h>
+#include <string.h>
+
+static inline unsigned int lowest_bit(uint8_t mask) {
+
+  unsigned int shift = 0;
+  while (mask && !(mask & 1)) {
+    mask >>= 1;
+    ++shift;
+  }
+  return shift;
+}
+
+/*
+ * The destination bits an entry writes for a source byte value.
+ */
+static inline uint8_t entry_bits(const s_remapEntry * entry, uint8_t value) {
+
+  if (entry->field) {
+    unsigned int bits = (value & entry->srcMask) >> lowest_bit(entry->srcMask);
+    return (bits << lowest_bit(entry->dstMask)) & entry->dstMask;
+  }
+  return (value & entry->srcMask) ? entry->dstMask : 0x00;
+}
+
+/*
+ * Compile the entries into lookup tables.
+ *
+ * \return 0 in case of success, -1 if an entry is out of the reports or if there are too many byte pairs
+ */
+int remap_compile(s_remap * remap, const s_remapEntry * entries, unsigned int count,
+    unsigned int srcLength, unsigned int dstLength) {
+
+  memset(remap, 0x00, sizeof(*remap));
+
+  unsigned int i;
+  for (i = 0; i < count; ++i) {
+
+    const s_remapEntry * entry = entries + i;
+
+    if (entry->srcByte >= srcLength || entry->dstByte >= dstLength) {
+      fprintf(stderr, "remap entry %u is out of the reports\n", i);
+      return -1;
+    }
+
+    unsigned int l;
+    for (l = 0; l < remap->nbLuts; ++l) {
+      if (remap->luts[l].src == entry->srcByte && remap->luts[l].dst == entry->dstByte) {
+        break;
+      }
+    }
+    unsigned int c;
+    for (c = 0; c < remap->nbClears; ++c) {
+      if (remap->clears[c].dst == entry->dstByte) {
+        break;
+      }
+    }
+    if (l == REMAP_MAX_LUTS || c == REMAP_MAX_LUTS) {
+      fprintf(stderr, "remap entry %u: too many source and destination byte pairs\n", i);
+      return -1;
+    }
+    if (l == remap->nbLuts) {
+      remap->luts[l].src = entry->srcByte;
+      remap->luts[l].dst = entry->dstByte;
+      ++remap->nbLuts;
+    }
+    if (c == remap->nbClears) {
+      remap->clears[c].dst = entry->dstByte;
+      remap->clears[c].keep = 0xff;
+      ++remap->nbClears;
+    }
+
+    remap->clears[c].keep &= ~entry->dstMask;
+
+    unsigned int value;
+    for (value = 0; value < 256; ++value) {
+      remap->luts[l].lut[value] |= entry_bits(entry, value);
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Remap entry by entry, as the compiled tables do. This is the reference for remap_apply.
+ */
+void remap_apply_entries(const s_remapEntry * entries, unsigned int count, const uint8_t * src, uint8_t * dst) {
+
+  unsigned int i;
+  for (i = 0; i < count; ++i) {
+    dst[entries[i].dstByte] &= ~entries[i].dstMask;
+  }
+  for (i = 0; i < count; ++i) {
+    dst[entries[i].dstByte] |= entry_bits(entries + i, src[entries[i].srcByte]);
+  }
+}
+
+/*
+ * Read remap entries from a text file, one per line:
+ * <source byte> <source mask> <destination byte> <destination mask> [field]
+ * The values can be decimal or hexadecimal (0x prefix), # starts a comment.
+ *
+ * \return the number of entries, or -1 in case of error
+ */
+int remap_load(const char * file, s_remapEntry * entries, unsigned int max) {
+
+  FILE * fp = fopen(file, "r");
+  if (fp == NULL) {
+    perror(file);
+    return -1;
+  }
+
+  int count = 0;
+  unsigned int line = 0;
+  char buf[256];
+  while (fgets(buf, sizeof(buf), fp) != NULL) {
+
+    ++line;
+
+    char * comment = strchr(buf, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+
+    int values[5] = { 0 };
+    int nb = sscanf(buf, "%i %i %i %i %i", values, values + 1, values + 2, values + 3, values + 4);
+    if (nb <= 0) {
+      continue; // empty line
+    }
+
+    unsigned int i;
+    for (i = 0; i < 4 && nb >= 4 && values[i] >= 0 && values[i] <= 0xff; ++i) {}
+    if (i < 4 || (unsigned int)count == max) {
+      fprintf(stderr, "%s:%u: invalid remap entry\n", file, line);
+      fclose(fp);
+      return -1;
+    }
+
+    entries[count].srcByte = values[0];
+    entries[count].srcMask = values[1];
+    entries[count].dstByte = values[2];
+    entries[count].dstMask = values[3];
+    entries[count].field = (nb == 5 && values[4]) ? 1 : 0;
+    ++count;
+  }
+
+  fclose(fp);
+
+  return count;
+}
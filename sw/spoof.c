@@ -0,0 +1,221 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#include <spoof.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void profile_path(char * path, size_t size, const char * dir, int vid, int pid) {
+
+  snprintf(path, size, "%s/%04x_%04x.spoof", dir, vid, pid);
+}
+
+static int is_record_type(uint8_t type) {
+
+  return type == E_TYPE_DESCRIPTORS || type == E_TYPE_INDEX || type == E_TYPE_ENDPOINTS;
+}
+
+/*
+ * Map the spoof profile of a device from a profile directory.
+ * The mapping is private and writable, as the endpoint flags are set before they are sent.
+ *
+ * \return 0 in case of success, 1 if the directory has no profile for the device, -1 in case of error
+ */
+int spoof_profile_load(const char * dir, int vid, int pid, s_spoofProfile * profile) {
+
+  memset(profile, 0x00, sizeof(*profile));
+
+  char path[256];
+  profile_path(path, sizeof(path), dir, vid, pid);
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return 1;
+    }
+    perror(path);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror(path);
+    close(fd);
+    return -1;
+  }
+
+  if ((size_t)st.st_size < sizeof(s_spoofProfileHeader)) {
+    fprintf(stderr, "%s: truncated spoof profile\n", path);
+    close(fd);
+    return -1;
+  }
+
+  void * map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+
+  profile->map = map;
+  profile->size = st.st_size;
+
+  const s_spoofProfileHeader * header = map;
+  if (header->magic != SPOOF_PROFILE_MAGIC || header->version != SPOOF_PROFILE_VERSION) {
+    fprintf(stderr, "%s: not a spoof profile, or an unsupported version\n", path);
+    spoof_profile_unload(profile);
+    return -1;
+  }
+  if (header->vid != vid || header->pid != pid) {
+    fprintf(stderr, "%s: the profile is for %04x:%04x\n", path, header->vid, header->pid);
+    spoof_profile_unload(profile);
+    return -1;
+  }
+  if (header->length != st.st_size - sizeof(*header)) {
+    fprintf(stderr, "%s: truncated spoof profile\n", path);
+    spoof_profile_unload(profile);
+    return -1;
+  }
+
+  uint8_t * records = (uint8_t *)(header + 1);
+  uint32_t checksum = CONFIG_HASH_INIT;
+  uint32_t i;
+  for (i = 0; i < header->length; ++i) {
+    checksum = config_hash(checksum, records[i]);
+  }
+  if (checksum != header->checksum) {
+    fprintf(stderr, "%s: bad checksum\n", path);
+    spoof_profile_unload(profile);
+    return -1;
+  }
+
+  profile->frames = calloc(header->nbRecords + 1, sizeof(*profile->frames));
+  if (profile->frames == NULL) {
+    fprintf(stderr, "%s: can't allocate the frames\n", path);
+    spoof_profile_unload(profile);
+    return -1;
+  }
+
+  uint8_t * ptr = records;
+  uint32_t stored = 0;
+  for (i = 0; i < header->nbRecords; ++i) {
+    const s_spoofRecordHeader * record = (const s_spoofRecordHeader *)ptr;
+    if (ptr + sizeof(*record) > records + header->length
+        || ptr + sizeof(*record) + record->length > records + header->length
+        || !is_record_type(record->type)) {
+      fprintf(stderr, "%s: invalid record %u\n", path, i);
+      spoof_profile_unload(profile);
+      return -1;
+    }
+    profile->frames[i].type = record->type;
+    profile->frames[i].len = record->length;
+    profile->frames[i].pkt = ptr + sizeof(*record);
+    ptr += sizeof(*record) + record->length;
+    if (record->type == E_TYPE_DESCRIPTORS || record->type == E_TYPE_INDEX) {
+      stored += record->length;
+    }
+  }
+  profile->frames[i].type = E_TYPE_RESET;
+
+  // the adapter stores the descriptors and their index
+  if (stored > MAX_STORED_CONFIG_SIZE) {
+    fprintf(stderr, "%s: the descriptors don't fit into the adapter EEPROM (%u > %u bytes)\n", path, stored, MAX_STORED_CONFIG_SIZE);
+    spoof_profile_unload(profile);
+    return -1;
+  }
+
+  profile->vid = header->vid;
+  profile->pid = header->pid;
+  profile->handlerVid = header->handlerVid;
+  profile->handlerPid = header->handlerPid;
+
+  return 0;
+}
+
+void spoof_profile_unload(s_spoofProfile * profile) {
+
+  if (profile->map != NULL) {
+    munmap(profile->map, profile->size);
+  }
+  free(profile->frames);
+  memset(profile, 0x00, sizeof(*profile));
+}
+
+/*
+ * Save the descriptors, index and endpoints frames of a device into a profile directory.
+ *
+ * \return 0 in case of success, -1 in case of error
+ */
+int spoof_profile_save(const char * dir, int vid, int pid, int handlerVid, int handlerPid, const SPOOF_PKT * frames) {
+
+  s_spoofProfileHeader header = {
+    .magic = SPOOF_PROFILE_MAGIC,
+    .version = SPOOF_PROFILE_VERSION,
+    .vid = vid,
+    .pid = pid,
+    .handlerVid = handlerVid,
+    .handlerPid = handlerPid,
+    .checksum = CONFIG_HASH_INIT,
+  };
+
+  const SPOOF_PKT * frame;
+  for (frame = frames; frame->type != E_TYPE_RESET; ++frame) {
+    if (!is_record_type(frame->type)) {
+      continue;
+    }
+    s_spoofRecordHeader record = { .type = frame->type, .length = frame->len };
+    unsigned int i;
+    for (i = 0; i < sizeof(record); ++i) {
+      header.checksum = config_hash(header.checksum, ((uint8_t *)&record)[i]);
+    }
+    for (i = 0; i < frame->len; ++i) {
+      header.checksum = config_hash(header.checksum, frame->pkt[i]);
+    }
+    header.length += sizeof(record) + frame->len;
+    ++header.nbRecords;
+  }
+
+  char path[256];
+  profile_path(path, sizeof(path), dir, vid, pid);
+  char tmp[sizeof(path) + 4];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+  FILE * fp = fopen(tmp, "wb");
+  if (fp == NULL) {
+    perror(tmp);
+    return -1;
+  }
+
+  int ret = fwrite(&header, sizeof(header), 1, fp) == 1 ? 0 : -1;
+  for (frame = frames; ret == 0 && frame->type != E_TYPE_RESET; ++frame) {
+    if (!is_record_type(frame->type)) {
+      continue;
+    }
+    s_spoofRecordHeader record = { .type = frame->type, .length = frame->len };
+    if (fwrite(&record, sizeof(record), 1, fp) != 1 || (frame->len && fwrite(frame->pkt, frame->len, 1, fp) != 1)) {
+      ret = -1;
+    }
+  }
+
+  if (fclose(fp) != 0 || ret < 0) {
+    perror(tmp);
+    remove(tmp);
+    return -1;
+  }
+
+  if (rename(tmp, path) < 0) {
+    perror(path);
+    remove(tmp);
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+#include <stats.h>
+#include <string.h>
+
+void stats_hist_init(s_histogram * hist, const char * name, unsigned int binUs) {
+
+  memset(hist, 0x00, sizeof(*hist));
+  hist->name = name;
+  hist->binUs = binUs;
+}
+
+void stats_hist_add(s_histogram * hist, double us) {
+
+  if (us < 0) {
+    us = 0;
+  }
+
+  unsigned int bin = us / hist->binUs;
+  if (bin < STATS_BINS) {
+    ++hist->bins[bin];
+  } else {
+    ++hist->overflow;
+  }
+
+  if (hist->count == 0 || us < hist->min) {
+    hist->min = us;
+  }
+  if (us > hist->max) {
+    hist->max = us;
+  }
+  hist->sum += us;
+  ++hist->count;
+}
+
+/*
+ * Upper bound of the bin that holds the given fraction of the values.
+ */
+static double percentile(const s_histogram * hist, double fraction) {
+
+  unsigned int target = hist->count * fraction;
+  unsigned int total = 0;
+  unsigned int i;
+  for (i = 0; i < STATS_BINS; ++i) {
+    total += hist->bins[i];
+    if (total > target) {
+      return (i + 1) * hist->binUs;
+    }
+  }
+  return hist->max;
+}
+
+void stats_hist_print(FILE * file, const s_histogram * hist) {
+
+  if (hist->count == 0) {
+    fprintf(file, "\n#s:%s: no sample", hist->name);
+    return;
+  }
+
+  fprintf(file, "\n#s:%s: %u samples, min %.0f us, avg %.0f us, p50 < %.0f us, p99 < %.0f us, max %.0f us",
+      hist->name, hist->count, hist->min, hist->sum / hist->count,
+      percentile(hist, 0.5), percentile(hist, 0.99), hist->max);
+
+  unsigned int i;
+  for (i = 0; i < STATS_BINS; ++i) {
+    if (hist->bins[i]) {
+      fprintf(file, "\n#s:  %5u - %5u us: %u", i * hist->binUs, (i + 1) * hist->binUs, hist->bins[i]);
+    }
+  }
+  if (hist->overflow) {
+    fprintf(file, "\n#s:  %5u -       us: %u", STATS_BINS * hist->binUs, hist->overflow);
+  }
+}
+
+/*
+ * One line per bin: name,lower bound (us),upper bound (us),count
+ */
+void stats_hist_export(FILE * file, const s_histogram * hist) {
+
+  unsigned int i;
+  for (i = 0; i < STATS_BINS; ++i) {
+    fprintf(file, "%s,%u,%u,%u\n", hist->name, i * hist->binUs, (i + 1) * hist->binUs, hist->bins[i]);
+  }
+  fprintf(file, "%s,%u,,%u\n", hist->name, STATS_BINS * hist->binUs, hist->overflow);
+}
+
+void stats_clock_init(s_clockSync * sync) {
+
+  memset(sync, 0x00, sizeof(*sync));
+}
+
+/*
+ * Least squares fit of host = offset + adapter * (1 + drift),
+ * using the samples with a round trip close to the best one.
+ */
+static void fit(s_clockSync * sync) {
+
+  double maxRtt = sync->minRtt * 1.5 + 100;
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  unsigned int n = 0;
+  unsigned int i;
+
+  double x0 = sync->samples[0].adapter;
+
+  for (i = 0; i < sync->nbSamples; ++i) {
+    if (sync->samples[i].rtt > maxRtt) {
+      continue;
+    }
+    double x = sync->samples[i].adapter - x0;
+    double y = sync->samples[i].host - sync->samples[i].adapter;
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+    ++n;
+  }
+
+  if (n == 0) {
+    return;
+  }
+
+  double den = n * sxx - sx * sx;
+  double slope = (n > 1 && den != 0) ? (n * sxy - sx * sy) / den : 0;
+
+  sync->drift = slope;
+  sync->offset = (sy - slope * sx) / n - slope * x0;
+  sync->valid = 1;
+}
+
+void stats_clock_add(s_clockSync * sync, double sent, double received, double adapter) {
+
+  double rtt = received - sent;
+
+  sync->samples[sync->next].host = sent + rtt / 2;
+  sync->samples[sync->next].adapter = adapter;
+  sync->samples[sync->next].rtt = rtt;
+
+  sync->next = (sync->next + 1) % STATS_CLOCK_SAMPLES;
+  if (sync->nbSamples < STATS_CLOCK_SAMPLES) {
+    ++sync->nbSamples;
+  }
+
+  if (sync->nbSamples == 1) {
+    sync->avgRtt = rtt;
+  } else {
+    sync->avgRtt += (rtt - sync->avgRtt) / 8;
+  }
+
+  sync->minRtt = sync->samples[0].rtt;
+  unsigned int i;
+  for (i = 1; i < sync->nbSamples; ++i) {
+    if (sync->samples[i].rtt < sync->minRtt) {
+      sync->minRtt = sync->samples[i].rtt;
+    }
+  }
+
+  fit(sync);
+}
+
+double stats_clock_to_host(const s_clockSync * sync, double adapter) {
+
+  return sync->offset + adapter * (1 + sync->drift);
+}
+
+double stats_clock_to_adapter(const s_clockSync * sync, double host) {
+
+  return (host - sync->offset) / (1 + sync->drift);
+}
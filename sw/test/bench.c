@@ -0,0 +1,711 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+/*
+ * Checks and timings of the conversion of the wheel reports, run by make check.
+ * The proxy is included for its static functions and tables.
+ */
+
+#include "../proxy.c"
+#include <unistd.h>
+
+#define BENCH_REPORTS 1000000
+
+// defined by usbxtract.c, read by the adapter
+int vid = 0, pid = 0, sbaud = 0;
+
+/*
+ * The converters of the spoofed devices as they were before the remap tables, one test per button:
+ * the reference the hand-written and the generated converters are checked against.
+ */
+static int ref_ps2_df_convert (char *rep, int rl, char *out)
+{
+  s_report_dfPs2 * report = (s_report_dfPs2 *)out;
+  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_10BITS);
+  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  report->buttonsAndWheel = whl & 0xffff;
+  if (rep[G29_LB_IDX] & G29_L1_MASK)
+    report->buttonsAndWheel |= DF_L1_MASK;
+  if (rep[G29_LB_IDX] & G29_R1_MASK)
+    report->buttonsAndWheel |= DF_R1_MASK;
+  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
+    report->buttonsAndWheel |= DF_SQUARE_MASK;
+  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
+    report->buttonsAndWheel |= DF_CROSS_MASK;
+  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
+    report->buttonsAndWheel |= DF_CIRCLE_MASK;
+  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
+    report->buttonsAndWheel |= DF_TRIANGLE_MASK;
+  //hat
+  report->hat = rep[G29_HB_IDX] & 0x0f;
+  //buttons
+  report->buttons = 0x00;
+  if (rep[G29_LB_IDX] & G29_L2_MASK)
+    report->buttons |= DF_L2_MASK;
+  if (rep[G29_LB_IDX] & G29_R2_MASK)
+    report->buttons |= DF_R2_MASK;
+  if (rep[G29_LB_IDX] & G29_L3_MASK)
+    report->buttons |= DF_L3_MASK;
+  if (rep[G29_LB_IDX] & G29_R3_MASK)
+    report->buttons |= DF_R3_MASK;
+  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
+    report->buttons |= DF_SELECT_MASK;
+  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
+    report->buttons |= DF_START_MASK;
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
+  return WHL_PS2_DF_REPORT_LEN;
+}
+
+static int ref_ps2_dfp_convert (char *rep, int rl, char *out)
+{
+  s_report_dfpPs2 * report = (s_report_dfpPs2 *)out;
+  memcpy ((void *)report, (void *)&whl_ps2_dfp_report_default, WHL_PS2_DFP_REPORT_LEN);
+  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_14BITS);
+  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
+  report->buttonsAndWheel = whl & 0xffff;
+  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
+    report->buttonsAndWheel |= DFP_SQUARE_MASK;
+  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
+    report->buttonsAndWheel |= DFP_CROSS_MASK;
+  //hat
+  report->hatAndButtons = (rep[G29_HB_IDX] & 0x0f) << 12;
+  if (rep[G29_LB_IDX] & G29_L1_MASK)
+    report->hatAndButtons |= DFP_L1_MASK;
+  if (rep[G29_LB_IDX] & G29_R1_MASK)
+    report->hatAndButtons |= DFP_R1_MASK;
+  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
+    report->hatAndButtons |= DFP_CIRCLE_MASK;
+  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
+    report->hatAndButtons |= DFP_TRIANGLE_MASK;
+  if (rep[G29_LB_IDX] & G29_L2_MASK)
+    report->hatAndButtons |= DFP_L2_MASK;
+  if (rep[G29_LB_IDX] & G29_R2_MASK)
+    report->hatAndButtons |= DFP_R2_MASK;
+  if (rep[G29_LB_IDX] & G29_L3_MASK)
+    report->hatAndButtons |= DFP_L3_MASK;
+  if (rep[G29_LB_IDX] & G29_R3_MASK)
+    report->hatAndButtons |= DFP_R3_MASK;
+  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
+    report->hatAndButtons |= DFP_SELECT_MASK;
+  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
+    report->hatAndButtons |= DFP_START_MASK;
+  return WHL_PS2_DFP_REPORT_LEN;
+}
+
+static int ref_ps3_dfgt_convert (char *rep, int rl, char *out)
+{
+  s_report_dfgtPs3 * report = (s_report_dfgtPs3 *)out;
+  //wheel and pedals
+  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_14BITS);
+  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  //hat and buttons
+  report->hatAndButtons = rep[G29_HB_IDX] & 0x0f;
+  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
+    report->hatAndButtons |= DFGT_SQUARE_MASK;
+  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
+    report->hatAndButtons |= DFGT_CROSS_MASK;
+  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
+    report->hatAndButtons |= DFGT_CIRCLE_MASK;
+  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
+    report->hatAndButtons |= DFGT_TRIANGLE_MASK;
+  //buttons
+  report->buttons = 0x00;
+  if (rep[G29_LB_IDX] & G29_L1_MASK)
+    report->buttons |= G27_L1_MASK;
+  if (rep[G29_LB_IDX] & G29_R1_MASK)
+    report->buttons |= G27_R1_MASK;
+  if (rep[G29_LB_IDX] & G29_L2_MASK)
+    report->buttons |= G27_L2_MASK;
+  if (rep[G29_LB_IDX] & G29_R2_MASK)
+    report->buttons |= G27_R2_MASK;
+  if (rep[G29_LB_IDX] & G29_L3_MASK)
+    report->buttons |= G27_L3_MASK;
+  if (rep[G29_LB_IDX] & G29_R3_MASK)
+    report->buttons |= G27_R3_MASK;
+  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
+    report->buttons |= G27_SELECT_MASK;
+  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
+    report->buttons |= G27_START_MASK;
+  if (rep[G29_PS_IDX] & G29_PS_MASK)
+    report->buttons3 = 0x7f;
+  else
+    report->buttons3 = 0x7e;
+  report->wheel = (whl & 0xffff);
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
+  return WHL_PS3_DFGT_REPORT_LEN;
+}
+
+static int ref_ps3_g27_convert (char *rep, int rl, char *out)
+{
+  s_report_g27Ps3 * report = (s_report_g27Ps3 *)out;
+  //wheel and pedals
+  long whl = get_cmap (get_ushort (rep, 44), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_14BITS);
+  long acc = get_cmap (get_ushort (rep, 46), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  long brk = get_cmap (get_ushort (rep, 48), 0, MAX_AXIS_VALUE_16BITS, 0, MAX_AXIS_VALUE_8BITS);
+  //hat and buttons
+  report->hatAndButtons = rep[G29_HB_IDX] & 0x0f;
+  if (rep[G29_PB_IDX] & G29_SQUARE_MASK)
+    report->hatAndButtons |= DFGT_SQUARE_MASK;
+  if (rep[G29_PB_IDX] & G29_CROSS_MASK)
+    report->hatAndButtons |= DFGT_CROSS_MASK;
+  if (rep[G29_PB_IDX] & G29_CIRCLE_MASK)
+    report->hatAndButtons |= DFGT_CIRCLE_MASK;
+  if (rep[G29_PB_IDX] & G29_TRIANGLE_MASK)
+    report->hatAndButtons |= DFGT_TRIANGLE_MASK;
+  //buttons
+  report->buttons = 0x00;
+  if (rep[G29_LB_IDX] & G29_L1_MASK)
+    report->buttons |= G27_L1_MASK;
+  if (rep[G29_LB_IDX] & G29_R1_MASK)
+    report->buttons |= G27_R1_MASK;
+  if (rep[G29_LB_IDX] & G29_L2_MASK)
+    report->buttons |= G27_L2_MASK;
+  if (rep[G29_LB_IDX] & G29_R2_MASK)
+    report->buttons |= G27_R2_MASK;
+  if (rep[G29_LB_IDX] & G29_L3_MASK)
+    report->buttons |= G27_L3_MASK;
+  if (rep[G29_LB_IDX] & G29_R3_MASK)
+    report->buttons |= G27_R3_MASK;
+  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
+    report->buttons |= G27_SELECT_MASK;
+  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK)
+    report->buttons |= G27_START_MASK;
+  report->buttonsAndWheel = (whl & 0xffff)<<2;
+  if (rep[G29_LB_IDX] & G29_OPTIONS_MASK) // for NFS Shift 2
+    report->buttonsAndWheel |= G27_L5_MASK;
+  if (rep[G29_LB_IDX] & G29_SHARE_MASK)
+    report->buttonsAndWheel |= G27_L4_MASK;
+  report->gasPedal = acc & 0xff;
+  report->brakePedal = brk & 0xff;
+  return WHL_PS3_G27_REPORT_LEN;
+}
+
+static const struct
+{
+  int (*whl)(char *rep, int rl, char *out);
+  int (*ref)(char *rep, int rl, char *out);
+} references[] =
+{
+  { whl_ps2_df_convert, ref_ps2_df_convert },
+  { whl_ps2_dfp_convert, ref_ps2_dfp_convert },
+  { whl_ps3_dfgt_convert, ref_ps3_dfgt_convert },
+  { whl_ps3_g27_convert, ref_ps3_g27_convert },
+};
+
+/*
+ * Check the ends of a shaped axis of each kind: a 10% deadzone keeps the output at rest
+ * near the rest position, a 80% saturation gives the full deflection near the other end.
+ *
+ * \return 0 if the ends match, -1 otherwise
+ */
+static int check_axis_ends ()
+{
+  static const struct
+  {
+    const char * name;
+    int centered;
+    int inverted;
+    uint16_t input;
+    long output;
+  } ends[] =
+  {
+    { "wheel", 1, 0, 0x8000, 127 },
+    { "wheel", 1, 0, 0x8000 + 0x0c00, 127 },
+    { "wheel", 1, 0, 0x8000 - 0x0c00, 127 },
+    { "wheel", 1, 0, 0x0000, 0 },
+    { "wheel", 1, 0, 0x0400, 0 },
+    { "wheel", 1, 0, 0xffff, 255 },
+    { "wheel", 1, 0, 0xfc00, 255 },
+    { "pedal", 0, 0, 0x0000, 0 },
+    { "pedal", 0, 0, 0x1000, 0 },
+    { "pedal", 0, 0, 0xffff, 255 },
+    { "pedal", 0, 0, 0xe000, 255 },
+    { "inverted pedal", 0, 1, 0xffff, 255 },
+    { "inverted pedal", 0, 1, 0xf000, 255 },
+    { "inverted pedal", 0, 1, 0x0000, 0 },
+    { "inverted pedal", 0, 1, 0x2000, 0 },
+  };
+  int ret = 0;
+  unsigned int i;
+  for (i = 0; i < sizeof(ends) / sizeof(*ends); ++i)
+  {
+    s_axis axis = { .config = { .deadzone = 10, .saturation = 80, .curve = 0, .range = 100 },
+        .centered = ends[i].centered, .inverted = ends[i].inverted };
+    if (axis_build (&axis, MAX_AXIS_VALUE_8BITS) < 0)
+    {
+      return -1;
+    }
+    long output = axis_map (&axis, ends[i].input, MAX_AXIS_VALUE_8BITS);
+    if (output != ends[i].output)
+    {
+      printf ("\n#e:the shaped %s maps 0x%04x to %ld instead of %ld", ends[i].name, ends[i].input, output, ends[i].output);
+      ret = -1;
+    }
+    free (axis.tables[0].lut);
+  }
+  return ret;
+}
+
+/*
+ * Check that a spoof profile whose descriptors don't fit into the adapter EEPROM is rejected
+ * at load, and that one that just fits is loaded.
+ *
+ * \return 0 if both are, -1 otherwise
+ */
+static int check_profile_size ()
+{
+  char dir[] = "/tmp/benchXXXXXX";
+  if (mkdtemp (dir) == NULL)
+  {
+    perror ("mkdtemp");
+    return -1;
+  }
+  static unsigned char descriptors[MAX_STORED_CONFIG_SIZE + 1];
+  static unsigned char index[sizeof(s_descriptorIndex)];
+  int ret = 0;
+  unsigned int extra;
+  for (extra = 0; extra < 2; ++extra)
+  {
+    SPOOF_PKT frames[] =
+    {
+      { E_TYPE_DESCRIPTORS, MAX_STORED_CONFIG_SIZE - sizeof(index) + extra, descriptors },
+      { E_TYPE_INDEX, sizeof(index), index },
+      { E_TYPE_RESET, 0, NULL },
+    };
+    s_spoofProfile profile;
+    if (spoof_profile_save (dir, 0x046d, 0xc29b, 0x046d, 0xc29b, frames) < 0)
+    {
+      ret = -1;
+      break;
+    }
+    int status = spoof_profile_load (dir, 0x046d, 0xc29b, &profile);
+    spoof_profile_unload (&profile);
+    if (status != (extra ? -1 : 0))
+    {
+      printf ("\n#e:a spoof profile of %u stored bytes is %s", MAX_STORED_CONFIG_SIZE + extra, extra ? "loaded" : "rejected");
+      ret = -1;
+    }
+  }
+  char path[sizeof(dir) + 16];
+  snprintf (path, sizeof(path), "%s/046d_c29b.spoof", dir);
+  remove (path);
+  rmdir (dir);
+  return ret;
+}
+
+/*
+ * Check that a rewritten packet size is rejected when it can't hold the largest report
+ * of the spoofed device: the converted reports for the IN endpoints of the wheels,
+ * the report descriptor otherwise.
+ *
+ * \return 0 if the sizes are rejected as expected, -1 otherwise
+ */
+static int check_rewrite_size ()
+{
+  static const struct
+  {
+    int vid;
+    int pid;
+    const char * spec;
+    int accepted;
+  } rewrites[] =
+  {
+    { 0x046d, 0xc29b, "in:size=8", 0 }, // 11-byte converted reports
+    { 0x046d, 0xc29b, "in:size=16", 1 },
+    { 0x046d, 0xc294, "in:size=8", 1 }, // 7-byte converted reports
+    { 0x0eb7, 0x0e04, "out:size=16", 0 }, // 32-byte force feedback reports
+    { 0x0eb7, 0x0e04, "out:size=32", 1 },
+  };
+  int ret = 0;
+  unsigned int i;
+  for (i = 0; i < sizeof(rewrites) / sizeof(*rewrites); ++i)
+  {
+    memset (&descRewrite, 0x00, sizeof(descRewrite));
+    if (descrewrite_parse (&descRewrite, rewrites[i].spec) < 0 || set_spoof_device (rewrites[i].vid, rewrites[i].pid) < 0)
+    {
+      ret = -1;
+      break;
+    }
+    if ((rewrite_descriptors () == 0) != rewrites[i].accepted)
+    {
+      printf ("\n#e:%04x:%04x: --rewrite %s is %s", rewrites[i].vid, rewrites[i].pid, rewrites[i].spec,
+          rewrites[i].accepted ? "rejected" : "accepted");
+      ret = -1;
+    }
+  }
+  memset (&descRewrite, 0x00, sizeof(descRewrite));
+  spoofFrames = NULL;
+  spoof_handlers_index = -1;
+  return ret;
+}
+
+static double bench_elapsed_ns (const struct timespec * start, unsigned int count)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return ((now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec)) / count;
+}
+
+/*
+ * Check the linear axis mappings against get_cmap() and the ends of the shaped ones, the size bounds
+ * of the spoof profiles and of the rewritten packets, the decode plan of the G29
+ * layout, the compiled remaps against the entry by entry remaps and the hand-written
+ * and generated converters against the reference ones on random wheel reports,
+ * then time the decoding and the remaps, as well as the whole conversions.
+ *
+ * \return 0 if all the mappings match, -1 otherwise
+ */
+static int bench (unsigned int count)
+{
+  unsigned char (* reports)[sizeof(s_endpointPacket)] = malloc (count * sizeof(*reports));
+  if (reports == NULL)
+  {
+    PRINT_ERROR_OTHER ("failed to allocate the reports")
+    return -1;
+  }
+  srand (1);
+  unsigned int r, i;
+  for (r = 0; r < count; ++r)
+  {
+    for (i = 0; i < sizeof(*reports); ++i)
+    {
+      reports[r][i] = rand ();
+    }
+  }
+
+  int ret = 0;
+  volatile unsigned char sink = 0;
+
+  // without shaping, the axes must be mapped as get_cmap() does
+  const long maxima[] = { MAX_AXIS_VALUE_8BITS, MAX_AXIS_VALUE_10BITS, MAX_AXIS_VALUE_14BITS };
+  s_axis * axis = malloc (sizeof(*axis));
+  if (axis == NULL)
+  {
+    PRINT_ERROR_OTHER ("failed to allocate the axis")
+    free (reports);
+    return -1;
+  }
+  memset (axis, 0x00, sizeof(*axis));
+  axis->config = (s_axisConfig) AXIS_CONFIG_LINEAR;
+  for (i = 0; i < sizeof(maxima) / sizeof(*maxima); ++i)
+  {
+    if (axis_build (axis, maxima[i]) < 0)
+    {
+      ret = -1;
+      break;
+    }
+    unsigned int value;
+    for (value = 0; value <= MAX_AXIS_VALUE_16BITS; ++value)
+    {
+      if (axis_map (axis, value, maxima[i]) != get_cmap (value, 0, MAX_AXIS_VALUE_16BITS, 0, maxima[i]))
+      {
+        printf ("\n#e:the linear axis mapping to %ld differs for %u", maxima[i], value);
+        ret = -1;
+        break;
+      }
+    }
+  }
+  for (i = 0; i < AXIS_MAX_TABLES; ++i)
+  {
+    free (axis->tables[i].lut);
+  }
+  free (axis);
+  if (check_axis_ends () < 0 || check_profile_size () < 0 || check_rewrite_size () < 0)
+  {
+    ret = -1;
+  }
+
+  // the G29 reports decoded from their own layout must be unchanged, but the inverted pedals
+  static const uint8_t g29Descriptor[] =
+  {
+    0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, 0x85, 0x01, // joystick, report 1
+    0x06, 0x00, 0xff, 0x09, 0x20, 0x15, 0x00, 0x26, 0xff, 0x00, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02, // sticks
+    0x05, 0x01, 0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x75, 0x04, 0x95, 0x01, 0x81, 0x42, // hat
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x0e, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0e, 0x81, 0x02, // buttons
+    0x75, 0x06, 0x95, 0x01, 0x81, 0x03, 0x75, 0x08, 0x95, 0x23, 0x81, 0x03, // padding
+    0x05, 0x01, 0x09, 0x30, 0x09, 0x32, 0x09, 0x35, 0x15, 0x00, 0x27, 0xff, 0xff, 0x00, 0x00,
+    0x75, 0x10, 0x95, 0x03, 0x81, 0x02, // wheel, gas, brake
+    0xc0,
+  };
+  s_hidplan plan;
+  if (hidplan_compile (&plan, g29Descriptor, sizeof(g29Descriptor), whlDecodeTargets) < 0)
+  {
+    ret = -1;
+  }
+  else
+  {
+    unsigned char decoded[sizeof(*reports)];
+    for (r = 0; r < count; ++r)
+    {
+      reports[r][1] = 0x01;
+      memcpy (decoded, reports[r], sizeof(decoded));
+      hidplan_apply (&plan, reports[r] + 1, sizeof(*reports) - 1, decoded);
+      unsigned char hat = reports[r][G29_HB_IDX] & 0x0f;
+      if (memcmp (decoded, reports[r], G29_HB_IDX)
+          || decoded[G29_HB_IDX] != ((reports[r][G29_HB_IDX] & 0xf0) | (hat > 7 ? 8 : hat))
+          || memcmp (decoded + G29_LB_IDX, reports[r] + G29_LB_IDX, G29_GAS_IDX - G29_LB_IDX)
+          || get_ushort ((char *)decoded, G29_GAS_IDX) != MAX_AXIS_VALUE_16BITS - get_ushort ((char *)reports[r], G29_GAS_IDX)
+          || get_ushort ((char *)decoded, G29_BRAKE_IDX) != MAX_AXIS_VALUE_16BITS - get_ushort ((char *)reports[r], G29_BRAKE_IDX))
+      {
+        printf ("\n#e:the decoded report %u differs", r);
+        ret = -1;
+        break;
+      }
+    }
+
+    struct timespec start;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (r = 0; r < count; ++r)
+    {
+      hidplan_apply (&plan, reports[r] + 1, sizeof(*reports) - 1, decoded);
+      sink += decoded[G29_WHEEL_IDX];
+    }
+    printf ("\n#i:decode plan: %u operations, %.1f ns/report", plan.nbOps, bench_elapsed_ns (&start, count));
+  }
+
+  // the pedals of an input replace the pedals of the wheel reports, and only them
+  static const uint8_t pedalsDescriptor[] =
+  {
+    0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, // joystick
+    0x05, 0x02, 0x09, 0xc4, 0x09, 0xc5, 0x15, 0x00, 0x27, 0xff, 0xff, 0x00, 0x00,
+    0x75, 0x10, 0x95, 0x02, 0x81, 0x02, // accelerator, brake
+    0xc0,
+  };
+  const s_hidplanTarget pedalsTargets[] =
+  {
+    whlDecodeTargets[2], whlDecodeTargets[3], whlDecodeTargets[4], whlDecodeTargets[5], { HIDPLAN_NONE }
+  };
+  unsigned int savedInputs = nbInputs;
+  nbInputs = 1;
+  inputs[0].length = 4;
+  if (hidplan_compile (&inputs[0].plan, pedalsDescriptor, sizeof(pedalsDescriptor), pedalsTargets) < 0)
+  {
+    ret = -1;
+  }
+  else
+  {
+    for (r = 0; r < count; ++r)
+    {
+      memcpy (inputs[0].report, reports[(r + 1) % count], inputs[0].length);
+      const unsigned char * merged = (const unsigned char *)merge_inputs ((char *)reports[r], sizeof(*reports));
+      if (memcmp (merged, reports[r], G29_GAS_IDX)
+          || get_ushort ((char *)merged, G29_GAS_IDX) != MAX_AXIS_VALUE_16BITS - (inputs[0].report[0] | inputs[0].report[1] << 8)
+          || get_ushort ((char *)merged, G29_BRAKE_IDX) != MAX_AXIS_VALUE_16BITS - (inputs[0].report[2] | inputs[0].report[3] << 8)
+          || memcmp (merged + G29_BRAKE_IDX + 2, reports[r] + G29_BRAKE_IDX + 2, sizeof(*reports) - G29_BRAKE_IDX - 2))
+      {
+        printf ("\n#e:the merged report %u differs", r);
+        ret = -1;
+        break;
+      }
+    }
+
+    struct timespec start;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (r = 0; r < count; ++r)
+    {
+      memcpy (inputs[0].report, reports[(r + 1) % count], inputs[0].length);
+      sink += merge_inputs ((char *)reports[r], sizeof(*reports))[G29_GAS_IDX];
+    }
+    printf ("\n#i:merge of a pedals input: %u operations, %.1f ns/report", inputs[0].plan.nbOps, bench_elapsed_ns (&start, count));
+  }
+  inputs[0].length = 0;
+
+  // the buttons of an input, and the gears of a shifter, are ORed with the ones of the wheel reports
+  static const uint8_t buttonsDescriptor[] =
+  {
+    0x05, 0x01, 0x09, 0x04, 0xa1, 0x01, // joystick
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x07, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x07, 0x81, 0x02, // buttons
+    0x75, 0x01, 0x95, 0x01, 0x81, 0x03, // padding
+    0xc0,
+  };
+  const unsigned int buttonRoles[] = { INPUT_ROLE_BUTTONS, INPUT_ROLE_GEAR };
+  for (i = 0; i < sizeof(buttonRoles) / sizeof(*buttonRoles); ++i)
+  {
+    s_hidplanTarget targets[sizeof(whlDecodeTargets) / sizeof(*whlDecodeTargets) + sizeof(gearDecodeTargets) / sizeof(*gearDecodeTargets)];
+    unsigned int nbTargets = input_targets (buttonRoles[i], targets);
+    inputs[0].length = 1;
+    if (hidplan_compile (&inputs[0].plan, buttonsDescriptor, sizeof(buttonsDescriptor), targets) < 0)
+    {
+      ret = -1;
+      continue;
+    }
+    unsigned char expected[sizeof(*reports)];
+    for (r = 0; r < count; ++r)
+    {
+      inputs[0].report[0] = reports[(r + 1) % count][0] & 0x7f;
+      memcpy (expected, reports[r], sizeof(expected));
+      unsigned int t;
+      for (t = 0; t < nbTargets; ++t)
+      {
+        if (targets[t].kind == HIDPLAN_MERGED_BUTTON && targets[t].usage <= 7
+            && (inputs[0].report[0] & (1 << (targets[t].usage - 1))))
+        {
+          expected[targets[t].dstByte] |= targets[t].dstMask;
+        }
+      }
+      const unsigned char * merged = (const unsigned char *)merge_inputs ((char *)reports[r], sizeof(*reports));
+      if (memcmp (merged, expected, sizeof(expected)))
+      {
+        printf ("\n#e:the report %u merged with a %s input differs", r, buttonRoles[i] == INPUT_ROLE_GEAR ? "gear" : "buttons");
+        ret = -1;
+        break;
+      }
+    }
+  }
+  inputs[0].length = 0;
+  nbInputs = savedInputs;
+
+  const proc_list * handler;
+  for (handler = spoof_handlers; handler->vid; ++handler)
+  {
+    if (handler->whl == NULL)
+    {
+      continue;
+    }
+    unsigned int nbEntries;
+    for (nbEntries = 0; handler->whl_remap[nbEntries].dstMask; ++nbEntries) {}
+    if (remap_compile (&whlRemap, handler->whl_remap, nbEntries, sizeof(*reports), handler->whl_report_len) < 0)
+    {
+      ret = -1;
+      continue;
+    }
+
+    unsigned char expected[sizeof(s_endpointPacket)];
+    unsigned char out[sizeof(s_endpointPacket)];
+    for (r = 0; r < count; ++r)
+    {
+      memcpy (expected, handler->whl_report, handler->whl_report_len);
+      memcpy (out, handler->whl_report, handler->whl_report_len);
+      remap_apply_entries (handler->whl_remap, nbEntries, reports[r], expected);
+      remap_apply (&whlRemap, reports[r], out);
+      if (memcmp (expected, out, handler->whl_report_len))
+      {
+        printf ("\n#e:%s: the compiled remap differs for report %u", handler->pdv, r);
+        ret = -1;
+        break;
+      }
+    }
+
+    struct timespec start;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (r = 0; r < count; ++r)
+    {
+      remap_apply (&whlRemap, reports[r], out);
+      sink += out[1];
+    }
+    double lutNs = bench_elapsed_ns (&start, count);
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (r = 0; r < count; ++r)
+    {
+      remap_apply_entries (handler->whl_remap, nbEntries, reports[r], out);
+      sink += out[1];
+    }
+    double entriesNs = bench_elapsed_ns (&start, count);
+
+    // the hand-written and the generated converters must convert as the if-chains did,
+    // into reports kept from one conversion to the next as in the proxy
+    int (* reference)(char *rep, int rl, char *out) = NULL;
+    for (i = 0; i < sizeof(references) / sizeof(*references); ++i)
+    {
+      if (references[i].whl == handler->whl)
+      {
+        reference = references[i].ref;
+      }
+    }
+    if (reference == NULL)
+    {
+      printf ("\n#e:%s: no reference converter", handler->pdv);
+      ret = -1;
+      continue;
+    }
+    const s_generatedConverter * converter;
+    for (converter = generatedConverters; converter->whl != NULL; ++converter)
+    {
+      if (converter->vid == handler->vid && converter->pid == handler->pid)
+      {
+        break;
+      }
+    }
+    // the tables are built as the proxy builds them, when it selects the converter
+    if (build_axes (handler->whl_axes) < 0 || (converter->whl != NULL && build_axes (converter->max) < 0))
+    {
+      ret = -1;
+      continue;
+    }
+    unsigned char generatedOut[sizeof(s_endpointPacket)];
+    memcpy (expected, handler->whl_report, handler->whl_report_len);
+    memcpy (out, handler->whl_report, handler->whl_report_len);
+    memcpy (generatedOut, handler->whl_report, handler->whl_report_len);
+    for (r = 0; r < count; ++r)
+    {
+      int length = reference ((char *)reports[r], sizeof(*reports), (char *)expected);
+      if (handler->whl ((char *)reports[r], sizeof(*reports), (char *)out) != length
+          || memcmp (expected, out, handler->whl_report_len))
+      {
+        printf ("\n#e:%s: the converter differs from the reference for report %u", handler->pdv, r);
+        ret = -1;
+        break;
+      }
+      if (converter->whl != NULL
+          && (converter->whl ((char *)reports[r], sizeof(*reports), (char *)generatedOut) != length
+              || memcmp (expected, generatedOut, handler->whl_report_len)))
+      {
+        printf ("\n#e:%s: the converter generated from %s differs from the reference for report %u", handler->pdv, converter->profile, r);
+        ret = -1;
+        break;
+      }
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (r = 0; r < count; ++r)
+    {
+      reference ((char *)reports[r], sizeof(*reports), (char *)expected);
+      sink += expected[1];
+    }
+    double referenceNs = bench_elapsed_ns (&start, count);
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (r = 0; r < count; ++r)
+    {
+      handler->whl ((char *)reports[r], sizeof(*reports), (char *)out);
+      sink += out[1];
+    }
+    double convertNs = bench_elapsed_ns (&start, count);
+
+    printf ("\n#i:%s: remap %.1f ns/report (%.1f ns entry by entry), conversion %.1f ns/report (%.1f ns with the if-chains)",
+        handler->pdv, lutNs, entriesNs, convertNs, referenceNs);
+
+    if (converter->whl == NULL)
+    {
+      continue;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (r = 0; r < count; ++r)
+    {
+      converter->whl ((char *)reports[r], sizeof(*reports), (char *)generatedOut);
+      sink += generatedOut[1];
+    }
+    printf (", generated conversion %.1f ns/report", bench_elapsed_ns (&start, count));
+  }
+
+  free (reports);
+
+  return ret;
+}
+
+int main (int argc, char * argv[])
+{
+  int ret = bench (BENCH_REPORTS);
+  printf ("\n#i:%s\n", ret < 0 ? "FAILED" : "passed");
+  return ret < 0 ? 1 : 0;
+}
@@ -20,6 +20,8 @@
 
 static char * port = NULL;
 static char * udev = NULL;
+static char * spoof = NULL;
+static int fakeWheel = 0;
 int vid = 0, pid = 0, sbaud = USART_BAUDRATE;
 int spvid = 0, sppid = 0;
 
@@ -40,8 +42,28 @@ int args_read(int argc, char *argv[])
     { "version", no_argument,       0, 'V' },
     { "tty",     required_argument, 0, 't' },
     { "device",  required_argument, 0, 'd' },
+    { "fake-wheel", no_argument,    0, 'f' },
     { "spoof",   required_argument, 0, 's' },
     { "capture", required_argument, 0, 'c' },
+    { "cached-in", no_argument,     0, 'C' },
+    { "local-hid", no_argument,     0, 'L' },
+    { "single-bank", no_argument,   0, 'S' },
+    { "stats",   no_argument,       0, 'i' },
+    { "histograms", required_argument, 0, 'H' },
+    { "jit",     no_argument,       0, 'J' },
+    { "static-feature", required_argument, 0, 'F' },
+    { "ctl-ttl", required_argument, 0, 'T' },
+    { "cache-report", required_argument, 0, 'R' },
+    { "latch",   required_argument, 0, 'l' },
+    { "remap",   required_argument, 0, 'M' },
+    { "axis",    required_argument, 0, 'A' },
+    { "decode",  no_argument,       0, 'D' },
+    { "generated", no_argument,     0, 'G' },
+    { "profiles", required_argument, 0, 'P' },
+    { "save-profile", required_argument, 0, 'W' },
+    { "rewrite", required_argument, 0, 'O' },
+    { "input", required_argument, 0, 'I' },
+    { "mirror", required_argument, 0, 'K' },
     { 0, 0, 0, 0 }
   };
 
@@ -50,7 +72,7 @@ int args_read(int argc, char *argv[])
     /* getopt_long stores the option index here. */
     int option_index = 0;
 
-    c = getopt_long (argc, argv, "b:c:d:t:d:s:Vh", long_options, &option_index);
+    c = getopt_long (argc, argv, "A:b:c:CDF:GH:I:JK:LM:O:P:R:ST:W:d:fl:t:d:s:iVh", long_options, &option_index);
 
     /* Detect the end of the options. */
     if (c == -1)
@@ -73,11 +95,103 @@ int args_read(int argc, char *argv[])
         adapter_debug (val);
       break;
 
+    case 'C':
+      proxy_set_cached_in (1);
+      break;
+
+    case 'L':
+      proxy_set_local_hid (1);
+      break;
+
+    case 'S':
+      proxy_set_single_bank (1);
+      break;
+
+    case 'i':
+      proxy_set_stats (1);
+      break;
+
+    case 'H':
+      proxy_set_histograms (optarg);
+      break;
+
+    case 'D':
+      proxy_set_decode (1);
+      break;
+
+    case 'G':
+      proxy_set_generated (1);
+      break;
+
+    case 'J':
+      proxy_set_jit (1);
+      break;
+
+    case 'F':
+      if (sscanf (optarg, "%i", &val) < 1 || val < 0 || val > 0xff)
+      {
+        printf ("invalid option: --static-feature %s\n", optarg);
+        ret = -1;
+      }
+      else
+        proxy_add_static_feature (val);
+      break;
+
+    case 'T':
+      if (sscanf (optarg, "%i", &val) < 1 || val < 0)
+      {
+        printf ("invalid option: --ctl-ttl %s\n", optarg);
+        ret = -1;
+      }
+      else
+        proxy_set_ctl_ttl (val);
+      break;
+
+    case 'R':
+      if (sscanf (optarg, "%i", &val) < 1 || val < 0 || val > 0xff)
+      {
+        printf ("invalid option: --cache-report %s\n", optarg);
+        ret = -1;
+      }
+      else
+        proxy_add_cached_report (val);
+      break;
+
+    case 'M':
+      if (proxy_set_remap (optarg) < 0)
+      {
+        printf ("invalid option: --remap %s\n", optarg);
+        ret = -1;
+      }
+      break;
+
+    case 'A':
+      if (proxy_set_axis (optarg) < 0)
+      {
+        printf ("invalid option: --axis %s\n", optarg);
+        ret = -1;
+      }
+      break;
+
+    case 'l':
+      if (proxy_set_latch_mask (optarg) < 0)
+      {
+        printf ("invalid option: --latch %s\n", optarg);
+        ret = -1;
+      }
+      break;
+
     case 'd':
       udev = optarg;
       ret++;
       break;
 
+    case 'f':
+      fakeWheel = 1;
+      proxy_set_fake_wheel (1);
+      ret++;
+      break;
+
     case 'b':
       sbaud = atoi (optarg);
       if (sbaud == 0)
@@ -92,13 +206,40 @@ int args_read(int argc, char *argv[])
         printf ("invalid option: --spoof %s\n", optarg);
         ret = -1;
       }
-      extern int set_spoof_device (int vid, int pid);
-      if (-1 == set_spoof_device (spvid, sppid))
+      spoof = optarg;
+      ret++;
+      break;
+
+    case 'P':
+      proxy_set_profile_dir (optarg);
+      break;
+
+    case 'W':
+      proxy_set_save_profile_dir (optarg);
+      break;
+
+    case 'O':
+      if (proxy_set_rewrite (optarg) < 0)
       {
-        printf ("unknown device: --spoof %s\n", optarg);
+        printf ("invalid option: --rewrite %s\n", optarg);
+        ret = -1;
+      }
+      break;
+
+    case 'I':
+      if (proxy_add_input (optarg) < 0)
+      {
+        printf ("invalid option: --input %s\n", optarg);
+        ret = -1;
+      }
+      break;
+
+    case 'K':
+      if (proxy_add_mirror (optarg) < 0)
+      {
+        printf ("invalid option: --mirror %s\n", optarg);
         ret = -1;
       }
-      ret++;
       break;
 
     case 'V':
@@ -118,6 +259,17 @@ int args_read(int argc, char *argv[])
     }
   }
 
+  // once all the options are read, as --profiles changes where the device is looked for
+  if (spoof != NULL && ret >= 0)
+  {
+    extern int set_spoof_device (int vid, int pid);
+    if (-1 == set_spoof_device (spvid, sppid))
+    {
+      printf ("unknown device: --spoof %s\n", spoof);
+      ret = -1;
+    }
+  }
+
   return ret;
 }
 
@@ -142,30 +294,37 @@ int main (int argc, char * argv[])
     usage ();
     return -1;
   }
-  if (udev == NULL)
-  {
-    usage ();
-    return -1;
-  }
-  if (sscanf (udev, "%04x:%04x", &vid, &pid) < 2)
+  if (fakeWheel)
   {
-    printf ("invalid option: --device %s\n", udev);
-    usage ();
-    return -1;
+    printf ("\n#i:initializing USB proxy with the fake wheel");
   }
-  if (vid == 0)
+  else
   {
-    printf ("invalid option: --device %s\n", udev);
-    usage ();
-    return -1;
-  }
-  if (pid == 0)
-  {
-    printf ("invalid option: --device %s\n", udev);
-    usage ();
-    return -1;
+    if (udev == NULL)
+    {
+      usage ();
+      return -1;
+    }
+    if (sscanf (udev, "%04x:%04x", &vid, &pid) < 2)
+    {
+      printf ("invalid option: --device %s\n", udev);
+      usage ();
+      return -1;
+    }
+    if (vid == 0)
+    {
+      printf ("invalid option: --device %s\n", udev);
+      usage ();
+      return -1;
+    }
+    if (pid == 0)
+    {
+      printf ("invalid option: --device %s\n", udev);
+      usage ();
+      return -1;
+    }
+    printf ("\n#i:initializing USB proxy with device %s", udev);
   }
-  printf ("\n#i:initializing USB proxy with device %s", udev);
   ret = proxy_init (vid, pid);  //T300RS
 
   if (ret == 0) 
@@ -0,0 +1,251 @@
+/*
+ Copyright (c) 2015 Mathieu Laurendeau <mat.lau@laposte.net>
+ License: GPLv3
+ */
+
+/*
+ * Compile the wheel profiles (sw/profiles) into specialized converters.
+ *
+ * build (done by the sw makefile):
+ * gcc -I../include -Iinclude -o ../tools/profilec ../tools/profilec.c remap.c
+ *
+ * usage: profilec <profile>... > converters.c
+ *
+ * Each profile becomes a straight-line converter: the axes are mapped
+ * and written at constant offsets, and the remap is compiled into
+ * constant tables with one load per source and destination byte pair.
+ */
+
+#include <remap.h>
+#include <protocol.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PROFILES 32
+#define MAX_NAME 64
+
+static const struct {
+  const char * name;
+  const char * index;
+} axes[] = {
+  { "wheel", "AXIS_WHEEL" },
+  { "gas", "AXIS_GAS" },
+  { "brake", "AXIS_BRAKE" },
+};
+
+#define NB_AXES (sizeof(axes) / sizeof(*axes))
+
+typedef struct {
+  const char * file;
+  char name[MAX_NAME];
+  unsigned int vid;
+  unsigned int pid;
+  unsigned int length;
+  struct {
+    int set;
+    unsigned int source; // the 16-bit little-endian axis in the source reports
+    unsigned int byte;
+    unsigned int bytes;
+    unsigned int max;
+    unsigned int shift;
+  } axes[NB_AXES];
+  s_remapEntry entries[REMAP_MAX_ENTRIES];
+  unsigned int nbEntries;
+} s_profile;
+
+/*
+ * \return 0 in case of success, -1 in case of error
+ */
+static int parse_profile(const char * file, s_profile * profile) {
+
+  FILE * fp = fopen(file, "r");
+  if (fp == NULL) {
+    perror(file);
+    return -1;
+  }
+
+  memset(profile, 0x00, sizeof(*profile));
+  profile->file = file;
+
+  int ret = 0;
+  unsigned int line = 0;
+  char buf[256];
+  while (ret == 0 && fgets(buf, sizeof(buf), fp) != NULL) {
+
+    ++line;
+
+    char * comment = strchr(buf, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+
+    char keyword[16];
+    int length;
+    if (sscanf(buf, "%15s%n", keyword, &length) < 1) {
+      continue; // empty line
+    }
+    const char * args = buf + length;
+
+    if (!strcmp(keyword, "name")) {
+      ret = sscanf(args, "%63s", profile->name) == 1 ? 0 : -1;
+    } else if (!strcmp(keyword, "handler")) {
+      ret = sscanf(args, "%i %i", &profile->vid, &profile->pid) == 2 ? 0 : -1;
+    } else if (!strcmp(keyword, "length")) {
+      ret = (sscanf(args, "%i", &profile->length) == 1 && profile->length > 0 && profile->length <= MAX_PAYLOAD_SIZE_EP) ? 0 : -1;
+    } else if (!strcmp(keyword, "axis")) {
+      char name[16];
+      unsigned int source, byte, bytes, max, shift = 0;
+      int nb = sscanf(args, "%15s %i %i %i %i %i", name, &source, &byte, &bytes, &max, &shift);
+      unsigned int i;
+      for (i = 0; i < NB_AXES && strcmp(name, axes[i].name); ++i) {}
+      if (nb < 5 || i == NB_AXES || bytes == 0 || bytes > 4 || max == 0 || max > 0xffff || shift > 16) {
+        ret = -1;
+      } else if (source + 2 > MAX_PAYLOAD_SIZE_EP + 1) {
+        fprintf(stderr, "%s:%u: the source of the %s axis is out of the source reports\n", file, line, name);
+        ret = -1;
+      } else {
+        profile->axes[i].set = 1;
+        profile->axes[i].source = source;
+        profile->axes[i].byte = byte;
+        profile->axes[i].bytes = bytes;
+        profile->axes[i].max = max;
+        profile->axes[i].shift = shift;
+      }
+    } else if (!strcmp(keyword, "remap")) {
+      int values[5] = { 0 };
+      int nb = sscanf(args, "%i %i %i %i %i", values, values + 1, values + 2, values + 3, values + 4);
+      unsigned int i;
+      for (i = 0; i < 4 && nb >= 4 && values[i] >= 0 && values[i] <= 0xff; ++i) {}
+      if (i < 4 || profile->nbEntries == REMAP_MAX_ENTRIES) {
+        ret = -1;
+      } else {
+        s_remapEntry * entry = profile->entries + profile->nbEntries++;
+        entry->srcByte = values[0];
+        entry->srcMask = values[1];
+        entry->dstByte = values[2];
+        entry->dstMask = values[3];
+        entry->field = (nb == 5 && values[4]) ? 1 : 0;
+      }
+    } else {
+      ret = -1;
+    }
+
+    if (ret < 0) {
+      fprintf(stderr, "%s:%u: invalid line\n", file, line);
+    }
+  }
+
+  fclose(fp);
+
+  if (ret == 0 && (profile->name[0] == '\0' || profile->vid == 0 || profile->length == 0)) {
+    fprintf(stderr, "%s: missing name, handler or length\n", file);
+    ret = -1;
+  }
+
+  unsigned int i;
+  for (i = 0; ret == 0 && i < NB_AXES; ++i) {
+    if (profile->axes[i].set && profile->axes[i].byte + profile->axes[i].bytes > profile->length) {
+      fprintf(stderr, "%s: the %s axis is out of the reports\n", file, axes[i].name);
+      ret = -1;
+    }
+  }
+
+  return ret;
+}
+
+static void print_converter(const s_profile * profile, const s_remap * remap) {
+
+  printf("\n/*\n * %s, from %s\n */\n", profile->name, profile->file);
+
+  unsigned int l, i;
+  for (l = 0; l < remap->nbLuts; ++l) {
+    printf("\nstatic const uint8_t %s_lut%u[256] = {", profile->name, l);
+    for (i = 0; i < 256; ++i) {
+      printf("%s0x%02x,", (i % 16) ? " " : "\n  ", remap->luts[l].lut[i]);
+    }
+    printf("\n};\n");
+  }
+
+  printf("\nstatic int %s_generated (char *rep, int rl, char *out)\n{\n", profile->name);
+  printf("  const uint8_t * src = (const uint8_t *)rep;\n");
+  printf("  uint8_t * dst = (uint8_t *)out;\n");
+
+  for (i = 0; i < NB_AXES; ++i) {
+    if (!profile->axes[i].set) {
+      continue;
+    }
+    printf("  uint32_t %s = axis_map (&whlAxes[%s], src[%u] | src[%u] << 8, %u)", axes[i].name, axes[i].index,
+        profile->axes[i].source, profile->axes[i].source + 1, profile->axes[i].max);
+    if (profile->axes[i].shift) {
+      printf(" << %u", profile->axes[i].shift);
+    }
+    printf(";\n");
+    unsigned int b;
+    for (b = 0; b < profile->axes[i].bytes; ++b) {
+      printf("  dst[%u] = %s", profile->axes[i].byte + b, axes[i].name);
+      if (b) {
+        printf(" >> %u", 8 * b);
+      }
+      printf(";\n");
+    }
+  }
+
+  unsigned int c;
+  for (c = 0; c < remap->nbClears; ++c) {
+    printf("  dst[%u] = ", remap->clears[c].dst);
+    if (remap->clears[c].keep) {
+      printf("(dst[%u] & 0x%02x)", remap->clears[c].dst, remap->clears[c].keep);
+    }
+    int first = !remap->clears[c].keep;
+    for (l = 0; l < remap->nbLuts; ++l) {
+      if (remap->luts[l].dst == remap->clears[c].dst) {
+        printf("%s%s_lut%u[src[%u]]", first ? "" : " | ", profile->name, l, remap->luts[l].src);
+        first = 0;
+      }
+    }
+    printf(";\n");
+  }
+
+  printf("  return %u;\n}\n", profile->length);
+}
+
+int main(int argc, char * argv[]) {
+
+  static s_profile profiles[MAX_PROFILES];
+
+  if (argc - 1 > MAX_PROFILES) {
+    fprintf(stderr, "too many profiles\n");
+    return 1;
+  }
+
+  printf("/*\n * Generated by tools/profilec, do not edit.\n */\n\n");
+  printf("#include <converters.h>\n");
+
+  int i;
+  for (i = 1; i < argc; ++i) {
+    s_profile * profile = profiles + i - 1;
+    if (parse_profile(argv[i], profile) < 0) {
+      return 1;
+    }
+    s_remap remap;
+    if (remap_compile(&remap, profile->entries, profile->nbEntries, MAX_PAYLOAD_SIZE_EP + 1, profile->length) < 0) {
+      fprintf(stderr, "%s: invalid remap\n", argv[i]);
+      return 1;
+    }
+    print_converter(profile, &remap);
+  }
+
+  printf("\nconst s_generatedConverter generatedConverters[] = {\n");
+  for (i = 0; i < argc - 1; ++i) {
+    printf("  { 0x%04x, 0x%04x, %s_generated, {", profiles[i].vid, profiles[i].pid, profiles[i].name);
+    unsigned int a;
+    for (a = 0; a < NB_AXES; ++a) {
+      printf(" %u,", profiles[i].axes[a].set ? profiles[i].axes[a].max : 0);
+    }
+    printf(" }, \"%s\" },\n", profiles[i].file);
+  }
+  printf("  { 0 },\n};\n");
+
+  return 0;
+}